@@ -1,6 +1,6 @@
 /*
  * ggroohauga - Alternative console and simulated amplifier interface
- * Copyright 2022,2025  Simon Arlott
+ * Copyright 2022,2025-2026  Simon Arlott
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -20,45 +20,337 @@
 
 #include <Arduino.h>
 
+#ifdef ARDUINO_ARCH_ESP32
+# include <WiFi.h>
+# include <esp_idf_version.h>
+# include <esp_netif.h>
+# include <esp_pm.h>
+# include <esp_pthread.h>
+# include <lwip/netif.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 namespace ggroohauga {
 
+#ifdef ARDUINO_ARCH_ESP32
+static Wakeup *input_wakeup = nullptr;
+static netif_input_fn network_input_next = nullptr;
+
+# if ARDUINO_USB_CDC_ON_BOOT
+static void serial_input_event(void *arg __attribute__((unused)),
+		esp_event_base_t base __attribute__((unused)),
+		int32_t id __attribute__((unused)), void *data __attribute__((unused))) {
+	input_wakeup->notify();
+}
+# endif
+
+/* Wi-Fi task, for every received packet */
+static err_t network_input(struct pbuf *p, struct netif *netif) {
+	err_t err = network_input_next(p, netif);
+
+	input_wakeup->notify();
+	return err;
+}
+#endif
+
 App::App()
 		: con_detect_(F("console"), F("detect"), CON_DETECT, LogicValue::Low,
-			5, 5, F("announce"), CON_ANNOUNCE, false, {}),
-		con_(F("console"), con_serial_, CON_TX, CON_RX, false, { con_detect_ }),
+			5, 5, F("announce"), CON_ANNOUNCE, false),
+		con_(F("console"), Direction::ConsoleToAmplifier, con_serial_, CON_UART, CON_TX, CON_RX, false, con_detect_),
 		amp_detect_(F("amplifier"), F("detect"), AMP_DETECT, LogicValue::Low,
-			0, 0, F("announce"), AMP_ANNOUNCE, false, {}),
+			0, 0, F("announce"), AMP_ANNOUNCE, false),
 		power_(F("amplifier"), F("power-in"), AMP_POWER_IN, LogicValue::High,
-			5, 5, F("power-out"), CON_POWER_OUT, true, [this] (bool on) {
-				if (on) {
-					power_on();
-				} else {
-					power_off();
-				}
-			}),
-		amp_(F("amplifier"), amp_serial_, AMP_TX, AMP_RX, true, { amp_detect_, power_ }) {
+			5, 5, F("power-out"), CON_POWER_OUT, true, PowerCallback{this}),
+		amp_(F("amplifier"), Direction::AmplifierToConsole, amp_serial_, AMP_UART, AMP_TX, AMP_RX, true, amp_detect_, power_) {
 }
 
 void App::start() {
 	app::App::start();
 
-	con_.start(amp_);
-	amp_.start(con_);
-	amp_.activate();
-	amp_detect_.activate();
-	power_.activate();
+	{
+		std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+		con_.start(amp_, bridge_);
+		amp_.start(con_, bridge_);
+		model_.start();
+		bridge_.filters.add(limiter_);
+		bridge_.filters.add(blocker_);
+		amp_.activate();
+		amp_detect_.activate();
+		power_.activate();
+	}
+
 	led_.begin();
+	show_led();
+
+	if (StatePublisher::ENABLED) {
+		publisher_.start();
+	}
+
+	if (IDLE_WAIT) {
+		configure_power();
+
+#ifdef ARDUINO_ARCH_ESP32
+		input_wakeup = &loop_wakeup();
+
+# if ARDUINO_USB_CDC_ON_BOOT && ARDUINO_USB_MODE
+		Serial.onEvent(ARDUINO_HW_CDC_RX_EVENT, serial_input_event);
+# elif ARDUINO_USB_CDC_ON_BOOT
+		Serial.onEvent(ARDUINO_USB_CDC_RX_EVENT, serial_input_event);
+# else
+		Serial.onReceive([] { input_wakeup->notify(); });
+# endif
+#endif
+
+		hook_input();
+	}
+
+	if (BRIDGE_TASK) {
+#ifdef ARDUINO_ARCH_ESP32
+		esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+
+		cfg.stack_size = BRIDGE_TASK_STACK_SIZE;
+		cfg.prio = BRIDGE_TASK_PRIORITY;
+		cfg.thread_name = "bridge";
+		cfg.pin_to_core = BRIDGE_TASK_CORE;
+		esp_pthread_set_cfg(&cfg);
+#endif
+
+		bridge_thread_ = std::thread{[this] { bridge_task(); }};
+
+#ifdef ARDUINO_ARCH_ESP32
+		cfg = esp_pthread_get_default_config();
+		esp_pthread_set_cfg(&cfg);
+#endif
+	} else {
+		/* Writing to flash must not delay forwarding in the main loop */
+#ifdef ARDUINO_ARCH_ESP32
+		esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+
+		cfg.stack_size = CAPTURE_TASK_STACK_SIZE;
+		cfg.prio = CAPTURE_TASK_PRIORITY;
+		cfg.thread_name = "capture";
+		cfg.pin_to_core = CAPTURE_TASK_CORE;
+		esp_pthread_set_cfg(&cfg);
+#endif
+
+		capture_thread_ = std::thread{[this] { capture_task(); }};
+
+#ifdef ARDUINO_ARCH_ESP32
+		cfg = esp_pthread_get_default_config();
+		esp_pthread_set_cfg(&cfg);
+#endif
+	}
 }
 
 void App::loop() {
 	app::App::loop();
 
+	if (!BRIDGE_TASK) {
+		bridge_loop();
+	}
+
+	log_frames();
+	amp_.complete();
+
+	if (BRIDGE_TASK) {
+		bridge_.capture.loop();
+	}
+
+	replay_.loop();
+	publisher_.loop();
+	scheduler_.run();
+
+	if (IDLE_WAIT) {
+		idle();
+	}
+}
+
+void App::idle() {
+	unsigned long timeout_us = MAX_IDLE_US;
+	unsigned long remaining_us;
+
+	if (bridge_.log_queue.size() > 0 || replay_.active()) {
+		return;
+	}
+
+	if (scheduler_.next(remaining_us)) {
+		timeout_us = std::min(timeout_us, remaining_us);
+	}
+
+	if (!BRIDGE_TASK) {
+		std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+		if (bridge_.scheduler.next(remaining_us)) {
+			timeout_us = std::min(timeout_us, remaining_us);
+		}
+	}
+
+	if (timeout_us > 0) {
+		loop_wakeup().wait(timeout_us);
+	}
+}
+
+Wakeup &App::loop_wakeup() {
+	return BRIDGE_TASK ? loop_wakeup_ : bridge_.wakeup;
+}
+
+/*
+ * The Wi-Fi station interface is created (and can be recreated) by the
+ * network configuration, so keep checking that its input is hooked.
+ * Packets that aren't for the shell also end the wait, but that's rare
+ * enough to not matter.
+ */
+void App::hook_input() {
+#ifdef ARDUINO_ARCH_ESP32
+	if (WiFi.getMode() & WIFI_MODE_STA) {
+		esp_netif_t *esp_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+		struct netif *netif = esp_netif
+			? static_cast<struct netif*>(esp_netif_get_netif_impl(esp_netif)) : nullptr;
+
+		if (netif && netif->input && netif->input != network_input) {
+			network_input_next = netif->input;
+			netif->input = network_input;
+		}
+	}
+#endif
+
+	input_timer_.start(scheduler_, ::micros() + INPUT_HOOK_INTERVAL_MS * 1000);
+}
+
+void App::configure_power() {
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_PM_ENABLE)
+# if ESP_IDF_VERSION_MAJOR >= 5
+	esp_pm_config_t config{};
+# else
+	esp_pm_config_esp32s3_t config{};
+# endif
+
+	config.max_freq_mhz = getCpuFrequencyMhz();
+	config.min_freq_mhz = IDLE_MIN_CPU_FREQ_MHZ;
+	config.light_sleep_enable = false;
+	esp_pm_configure(&config);
+#endif
+}
+
+void App::clear_stats() {
+	con_.clear_stats();
+	amp_.clear_stats();
+	bridge_.frames.clear_stats();
+	bridge_.log_overflow.clear();
+	bridge_.log_dropped.clear();
+	bridge_.capture.clear_stats();
+	bridge_.cache.clear_stats();
+	bridge_.wakeup.clear_stats();
+	loop_wakeup_.clear_stats();
+	bridge_.filters.clear_stats();
+	model_.clear_stats();
+	publisher_.clear_stats();
+}
+
+std::shared_ptr<FrameMonitor> App::monitor(bool console, bool amplifier, int opcode) {
+	auto monitor = std::make_shared<FrameMonitor>(bridge_, console, amplifier, opcode);
+
+	if (!monitor->start()) {
+		return nullptr;
+	}
+
+	return monitor;
+}
+
+void App::bridge_loop() {
 	con_.loop();
 	amp_.loop();
 
-	if (millis() - last_led_ms_ >= 1000) {
-		led_.show();
-		last_led_ms_ = millis();
+	std::unique_lock<std::mutex> lock{bridge_.mutex, std::defer_lock};
+
+	if (Bridge::CONCURRENT) {
+		lock.lock();
+	}
+
+	bridge_.scheduler.run();
+}
+
+void App::bridge_task() {
+	unsigned long blocked_ms = millis();
+
+	while (true) {
+		std::chrono::microseconds interval = BRIDGE_TASK_INTERVAL;
+		unsigned long remaining_us;
+
+		bridge_loop();
+
+		if (!IDLE_WAIT && !Device::RX_EVENTS) {
+			/*
+			 * Nothing ends a wait early when data is received, so keep
+			 * polling and only block occasionally to let lower priority
+			 * tasks on this core run.
+			 */
+			if (millis() - blocked_ms < BRIDGE_TASK_BLOCK_INTERVAL_MS) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			blocked_ms = millis();
+		}
+
+		if (IDLE_WAIT) {
+			/* Activity ends the wait, so the interval only limits idle time */
+			interval = std::chrono::microseconds{MAX_IDLE_US};
+		}
+
+		{
+			std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+			/* Wake up early if there's a deadline before the next interval */
+			if (bridge_.scheduler.next(remaining_us)) {
+				interval = std::min(interval, std::chrono::microseconds{remaining_us});
+			}
+		}
+
+		if (IDLE_WAIT || Device::RX_EVENTS) {
+			bridge_.wakeup.wait(interval.count());
+		} else {
+			std::this_thread::sleep_for(interval);
+		}
+	}
+}
+
+void App::capture_task() {
+	while (true) {
+		bridge_.capture.loop();
+		std::this_thread::sleep_for(CAPTURE_TASK_INTERVAL);
+	}
+}
+
+void App::log_frames() {
+	FrameHandle frame;
+
+	for (size_t i = 0; i < bridge_.log_queue.capacity()
+			&& bridge_.log_queue.pop(frame); i++) {
+		if (frame->direction() == Direction::ConsoleToAmplifier) {
+			con_.log_frame(*frame, trace_format_);
+		} else {
+			amp_.log_frame(*frame, trace_format_);
+		}
+	}
+}
+
+void App::show_led() {
+	led_.show();
+	led_timer_.start(scheduler_, micros() + LED_INTERVAL_MS * 1000);
+}
+
+void App::power_changed(bool on) {
+	if (on) {
+		power_on();
+	} else {
+		power_off();
 	}
 }
 
@@ -0,0 +1,232 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/benchmark.h"
+
+#ifdef GGROOHAUGA_SIMULATION
+
+#include <Arduino.h>
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "ggroohauga/app.h"
+#include "ggroohauga/device.h"
+#include "ggroohauga/fixture.h"
+#include "ggroohauga/sim.h"
+#include "ggroohauga/z906.h"
+
+namespace ggroohauga {
+
+namespace benchmark {
+
+static constexpr unsigned int ROUNDS = 10;
+static constexpr unsigned long ITERATIONS = 1000;
+
+#if defined(__x86_64__) || defined(__i386__)
+static constexpr const char *UNIT = "tsc";
+
+static inline uint64_t cycles() {
+	return __rdtsc();
+}
+#else
+static constexpr const char *UNIT = "ns";
+
+static inline uint64_t cycles() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+struct Result {
+	unsigned long iterations;
+	unsigned long bytes;
+	uint64_t cycles;
+};
+
+static void report(const char *name, const Result &result) {
+	double per_byte = result.bytes
+		? static_cast<double>(result.cycles) / result.bytes : 0;
+
+	std::printf("{\"name\": \"%s\", \"iterations\": %lu, \"bytes\": %lu, \"cycles\": %llu, \"cycles_per_byte\": %.3f, \"unit\": \"%s\"}\n",
+		name, result.iterations, result.bytes,
+		static_cast<unsigned long long>(result.cycles), per_byte, UNIT);
+	std::fflush(stdout);
+}
+
+/* Run the benchmark multiple times and report the fastest */
+static void measure(const char *name, const std::function<Result()> &func) {
+	Result best{0, 0, std::numeric_limits<uint64_t>::max()};
+
+	for (unsigned int i = 0; i < ROUNDS; i++) {
+		Result result = func();
+
+		if (result.cycles < best.cycles) {
+			best = result;
+		}
+	}
+
+	report(name, best);
+}
+
+/* Receive data with Device::loop() */
+static Result device_loop(const std::vector<uint8_t> &data, size_t per_loop) {
+	sim::Fixture fixture;
+	Result result{ITERATIONS, 0, 0};
+
+	for (unsigned long i = 0; i < ITERATIONS; i++) {
+		for (size_t j = 0; j < per_loop; j++) {
+			fixture.con_peer_.write(data.data(), data.size());
+		}
+
+		uint64_t start = cycles();
+		fixture.con_.loop();
+		result.cycles += cycles() - start;
+		result.bytes += data.size() * per_loop;
+
+		sim::advance_us(Device::CHAR_TIME_US * data.size() * per_loop);
+		fixture.run_timers();
+		fixture.drain();
+	}
+
+	return result;
+}
+
+/* Process complete frames with Device::inject(), which are reported when decoded */
+static Result device_report(bool trace) {
+	std::unique_ptr<sim::TraceHandler> handler;
+	sim::Fixture fixture;
+	Result result{ITERATIONS, 0, 0};
+	auto frame = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+
+	if (trace) {
+		handler.reset(new sim::TraceHandler{});
+	}
+
+	for (unsigned long i = 0; i < ITERATIONS; i++) {
+		unsigned long now_us = micros();
+		uint64_t start = cycles();
+
+		fixture.amp_.inject(frame.data(), frame.size(), now_us, now_us);
+		result.cycles += cycles() - start;
+		result.bytes += frame.size();
+
+		fixture.drain();
+	}
+
+	return result;
+}
+
+/* Toggle a monitored pin faster than the debounce time (each toggle counts as a byte) */
+static Result proxy_toggle() {
+	sim::Fixture fixture;
+	Result result{ITERATIONS, 0, 0};
+
+	for (unsigned long i = 0; i < ITERATIONS; i++) {
+		sim::drive(sim::Fixture::DETECT_PIN, (i & 1) ? HIGH : LOW);
+		sim::advance_us(i % 8 == 7 ? 10000 : 500);
+
+		uint64_t start = cycles();
+		fixture.con_.loop();
+		fixture.run_timers();
+		result.cycles += cycles() - start;
+		result.bytes++;
+	}
+
+	sim::drive(sim::Fixture::DETECT_PIN, -1);
+	return result;
+}
+
+/* Complete a status query through the whole application */
+static Result app_loop(App &app) {
+	const std::array<uint8_t, 1> query{z906::query_opcode(z906::Query::Status)};
+	auto reply = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	std::array<uint8_t, 256> buffer;
+	Result result{ITERATIONS, 0, 0};
+
+	for (unsigned long i = 0; i < ITERATIONS; i++) {
+		sim::console.write(query.data(), query.size());
+
+		uint64_t start = cycles();
+		app.loop();
+		result.cycles += cycles() - start;
+
+		while (sim::amplifier.read(buffer.data(), buffer.size()) > 0);
+		sim::amplifier.write(reply.data(), reply.size());
+
+		start = cycles();
+		app.loop();
+		result.cycles += cycles() - start;
+		result.bytes += query.size() + reply.size();
+
+		while (sim::console.read(buffer.data(), buffer.size()) > 0);
+		sim::advance_us(1000);
+	}
+
+	return result;
+}
+
+int run(App &app) {
+	auto frame = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	auto large = sim::make_frame(0x0B, UINT8_MAX);
+	auto garbage = sim::make_garbage(256);
+
+	sim::manual_clock(true);
+
+	measure("device_loop_back_to_back", [&frame] { return device_loop(frame, 4); });
+	measure("device_loop_large_frames", [&large] { return device_loop(large, 1); });
+	measure("device_loop_garbage", [&garbage] { return device_loop(garbage, 1); });
+	measure("device_report_trace_off", [] { return device_report(false); });
+	measure("device_report_trace_on", [] { return device_report(true); });
+	measure("proxy_toggle", proxy_toggle);
+
+	app.start();
+	sim::console.pacing(false);
+	sim::amplifier.pacing(false);
+	sim::console.begin(Device::BAUD_RATE, Device::UART_CONFIG);
+	sim::amplifier.begin(Device::BAUD_RATE, Device::UART_CONFIG);
+	sim::drive(App::AMP_POWER_IN, HIGH);
+
+	for (int i = 0; i < 100; i++) {
+		app.loop();
+		sim::advance_us(1000);
+	}
+
+	measure("app_loop", [&app] { return app_loop(app); });
+
+	/* The bridge and capture tasks can't be stopped, so exit without destroying them */
+	std::fflush(stdout);
+	std::_Exit(0);
+}
+
+} // namespace benchmark
+
+} // namespace ggroohauga
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/cache.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+
+#include "ggroohauga/z906.h"
+
+namespace ggroohauga {
+
+void ReplyCache::clear_stats() {
+	for (auto *counter : {&stats_.hits, &stats_.misses, &stats_.stored,
+			&stats_.invalidations, &stats_.saved_bytes}) {
+		counter->clear();
+	}
+}
+
+ReplyCache::Entry *ReplyCache::find(uint8_t opcode) {
+	for (auto &entry : entries_) {
+		if (entry.valid && entry.opcode == opcode) {
+			return &entry;
+		}
+	}
+
+	return nullptr;
+}
+
+bool ReplyCache::lookup(const z906::Message &request, const uint8_t *&reply,
+		size_t &reply_len) {
+	unsigned long window = window_ms();
+
+	if (window == 0 || request.direction != Direction::ConsoleToAmplifier
+			|| request.frame || !z906::idempotent(request)) {
+		return false;
+	}
+
+	unsigned long now_ms = ::millis();
+	Entry *entry = find(request.opcode);
+
+	if (entry && now_ms - entry->time_ms < window) {
+		reply = entry->reply.data();
+		reply_len = entry->reply_len;
+		stats_.hits.add();
+		stats_.saved_bytes.add(1 + reply_len);
+		return true;
+	}
+
+	stats_.misses.add();
+
+	if (pending_ && now_ms - pending_ms_ < REPLY_TIMEOUT_MS) {
+		/* The reply could be for either query */
+		pending_ = false;
+		return false;
+	}
+
+	pending_ = true;
+	pending_ms_ = now_ms;
+	pending_opcode_ = request.opcode;
+	return false;
+}
+
+void ReplyCache::response(const Frame &frame) {
+	if (!z906::valid_frame(frame.data(), frame.size())) {
+		/* Command acknowledgements don't change anything */
+		return;
+	}
+
+	if (!pending_ || ::millis() - pending_ms_ >= REPLY_TIMEOUT_MS) {
+		invalidate();
+		return;
+	}
+
+	pending_ = false;
+
+	if (frame.size() > MAX_REPLY_LEN) {
+		return;
+	}
+
+	Entry *entry = find(pending_opcode_);
+
+	if (!entry) {
+		/* Replace an unused entry or the oldest entry */
+		entry = &*std::min_element(entries_.begin(), entries_.end(),
+			[] (const Entry &a, const Entry &b) {
+				if (a.valid != b.valid) {
+					return !a.valid;
+				}
+				return (long)(a.time_ms - b.time_ms) < 0;
+			});
+	}
+
+	entry->valid = true;
+	entry->opcode = pending_opcode_;
+	entry->reply_len = frame.size();
+	entry->time_ms = pending_ms_;
+	std::copy(frame.data(), frame.data() + frame.size(), entry->reply.begin());
+	stats_.stored.add();
+}
+
+void ReplyCache::invalidate() {
+	bool valid = pending_;
+
+	for (auto &entry : entries_) {
+		valid |= entry.valid;
+		entry.valid = false;
+	}
+
+	pending_ = false;
+
+	if (valid) {
+		stats_.invalidations.add();
+	}
+}
+
+} // namespace ggroohauga
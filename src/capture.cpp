@@ -0,0 +1,396 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/capture.h"
+
+#include <Arduino.h>
+#ifdef GGROOHAUGA_SIMULATION
+# include <cstdio>
+#else
+# include <FS.h>
+# include <LittleFS.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+
+#include <uuid/log.h>
+
+#ifdef GGROOHAUGA_SIMULATION
+# define CAPTURE_PATH(name) name
+#else
+# define CAPTURE_PATH(name) "/" name
+#endif
+
+namespace ggroohauga {
+
+static constexpr const char *CURRENT_FILENAME = CAPTURE_PATH("capture.bin");
+static constexpr const char *PREVIOUS_FILENAME = CAPTURE_PATH("capture.old");
+
+#ifdef GGROOHAUGA_SIMULATION
+static bool file_begin() {
+	return true;
+}
+
+static bool file_append(const char *path, const uint8_t *data, size_t len) {
+	std::FILE *file = std::fopen(path, "ab");
+
+	if (!file) {
+		return false;
+	}
+
+	bool ok = std::fwrite(data, 1, len, file) == len;
+	return std::fclose(file) == 0 && ok;
+}
+
+static size_t file_read(const char *path, size_t offset, uint8_t *data, size_t len) {
+	std::FILE *file = std::fopen(path, "rb");
+	size_t count = 0;
+
+	if (file) {
+		if (std::fseek(file, offset, SEEK_SET) == 0) {
+			count = std::fread(data, 1, len, file);
+		}
+		std::fclose(file);
+	}
+
+	return count;
+}
+
+static size_t file_size(const char *path) {
+	std::FILE *file = std::fopen(path, "rb");
+	long size = 0;
+
+	if (file) {
+		if (std::fseek(file, 0, SEEK_END) == 0) {
+			size = std::max(0L, std::ftell(file));
+		}
+		std::fclose(file);
+	}
+
+	return size;
+}
+
+static void file_remove(const char *path) {
+	std::remove(path);
+}
+
+static bool file_rename(const char *from, const char *to) {
+	return std::rename(from, to) == 0;
+}
+#else
+static bool file_begin() {
+	return LittleFS.begin();
+}
+
+static bool file_append(const char *path, const uint8_t *data, size_t len) {
+	File file = LittleFS.open(path, "a");
+
+	if (!file) {
+		return false;
+	}
+
+	bool ok = file.write(data, len) == len;
+	file.close();
+	return ok;
+}
+
+static size_t file_read(const char *path, size_t offset, uint8_t *data, size_t len) {
+	File file = LittleFS.open(path, "r");
+	size_t count = 0;
+
+	if (file) {
+		if (file.seek(offset)) {
+			count = file.read(data, len);
+		}
+		file.close();
+	}
+
+	return count;
+}
+
+static size_t file_size(const char *path) {
+	File file = LittleFS.open(path, "r");
+	size_t size = 0;
+
+	if (file) {
+		size = file.size();
+		file.close();
+	}
+
+	return size;
+}
+
+static void file_remove(const char *path) {
+	if (LittleFS.exists(path)) {
+		LittleFS.remove(path);
+	}
+}
+
+static bool file_rename(const char *from, const char *to) {
+	return LittleFS.rename(from, to);
+}
+#endif
+
+Capture::Capture() : logger_(F("capture"), uuid::log::Facility::UUCP) {
+
+}
+
+bool Capture::start() {
+	std::lock_guard<std::mutex> lock{mutex_};
+
+	if (active()) {
+		return true;
+	}
+
+	if (!file_begin()) {
+		logger_.err(F("Unable to mount filesystem"));
+		stats_.errors.add();
+		return false;
+	}
+
+	file_remove(PREVIOUS_FILENAME);
+	file_remove(CURRENT_FILENAME);
+
+	if (!file_append(CURRENT_FILENAME, MAGIC.data(), MAGIC.size())) {
+		logger_.err(F("Unable to create %s"), CURRENT_FILENAME);
+		stats_.errors.add();
+		return false;
+	}
+
+	file_size_ = MAGIC.size();
+	last_flush_ms_ = millis();
+	tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+	active_.store(true, std::memory_order_release);
+
+	logger_.info(F("Capture started"));
+	return true;
+}
+
+void Capture::stop() {
+	if (active()) {
+		std::lock_guard<std::mutex> lock{mutex_};
+
+		active_.store(false, std::memory_order_release);
+		flush(true);
+
+		logger_.info(F("Capture stopped"));
+	}
+}
+
+void Capture::loop() {
+	std::lock_guard<std::mutex> lock{mutex_};
+
+	if (active()) {
+		flush(false);
+	}
+}
+
+size_t Capture::buffered() const {
+	return head_.load(std::memory_order_relaxed)
+		- tail_.load(std::memory_order_relaxed);
+}
+
+void Capture::clear_stats() {
+	stats_.records.clear();
+	stats_.overflow.clear();
+	stats_.written.clear();
+	stats_.errors.clear();
+}
+
+size_t Capture::read(size_t offset, uint8_t *data, size_t len) const {
+	std::lock_guard<std::mutex> lock{mutex_};
+
+	return read_locked(offset, data, len);
+}
+
+size_t Capture::read_locked(size_t offset, uint8_t *data, size_t len) const {
+	size_t previous_size = file_size(PREVIOUS_FILENAME);
+
+	if (offset < previous_size) {
+		return file_read(PREVIOUS_FILENAME, offset, data,
+			std::min(len, previous_size - offset));
+	} else {
+		return file_read(CURRENT_FILENAME, offset - previous_size, data, len);
+	}
+}
+
+bool Capture::read(size_t &offset, Record &record) const {
+	std::lock_guard<std::mutex> lock{mutex_};
+	std::array<uint8_t, RECORD_HEADER_LEN> header;
+
+	while (true) {
+		if (read_locked(offset, header.data(), header.size()) != header.size()) {
+			return false;
+		}
+
+		if (std::equal(header.begin(), header.end(), MAGIC.begin())) {
+			offset += MAGIC.size();
+		} else {
+			break;
+		}
+	}
+
+	record.time_us = header[0] | (header[1] << 8) | (header[2] << 16)
+		| (static_cast<unsigned long>(header[3]) << 24);
+	record.type = static_cast<RecordType>(header[4]);
+	record.flags = header[5];
+	record.length = header[6] | (header[7] << 8);
+
+	if (record.length > record.data.size()
+			|| read_locked(offset + header.size(), record.data.data(), record.length)
+				!= record.length) {
+		return false;
+	}
+
+	offset += header.size() + record.length;
+	return true;
+}
+
+void Capture::frame(const Frame &frame) {
+	if (active()) {
+		uint8_t flags = 0;
+
+		if (frame.direction() == Direction::AmplifierToConsole) {
+			flags |= FLAG_AMPLIFIER_TO_CONSOLE;
+		}
+
+		if (frame.discarded()) {
+			flags |= FLAG_DISCARDED;
+		}
+
+		record(frame.timestamp_us(), RecordType::Frame, flags,
+			frame.data(), frame.size());
+	}
+}
+
+void Capture::pin(uint8_t pin, bool high, unsigned long time_us) {
+	if (active()) {
+		record(time_us, RecordType::Pin, high ? FLAG_HIGH : 0, &pin, 1);
+	}
+}
+
+void Capture::record(unsigned long time_us, RecordType type, uint8_t flags,
+		const uint8_t *data, size_t len) {
+	size_t head = head_.load(std::memory_order_relaxed);
+	size_t tail = tail_.load(std::memory_order_acquire);
+	std::array<uint8_t, RECORD_HEADER_LEN> header{
+		static_cast<uint8_t>(time_us),
+		static_cast<uint8_t>(time_us >> 8),
+		static_cast<uint8_t>(time_us >> 16),
+		static_cast<uint8_t>(time_us >> 24),
+		static_cast<uint8_t>(type),
+		flags,
+		static_cast<uint8_t>(len),
+		static_cast<uint8_t>(len >> 8),
+	};
+
+	if (BUFFER_SIZE - (head - tail) < header.size() + len) {
+		stats_.overflow.add();
+		return;
+	}
+
+	for (size_t i = 0; i < header.size(); i++) {
+		buffer_[head++ % BUFFER_SIZE] = header[i];
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		buffer_[head++ % BUFFER_SIZE] = data[i];
+	}
+
+	head_.store(head, std::memory_order_release);
+	stats_.records.add();
+}
+
+void Capture::copy_from_buffer(size_t pos, uint8_t *data, size_t len) const {
+	for (size_t i = 0; i < len; i++) {
+		data[i] = buffer_[(pos + i) % BUFFER_SIZE];
+	}
+}
+
+void Capture::flush(bool all) {
+	while (true) {
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		size_t available = head_.load(std::memory_order_acquire) - tail;
+		size_t len = 0;
+
+		if (!available) {
+			break;
+		}
+
+		if (!all && available < BLOCK_SIZE
+				&& millis() - last_flush_ms_ < FLUSH_INTERVAL_MS) {
+			break;
+		}
+
+		/* Only write whole records, so that files always start with a record */
+		while (available - len >= RECORD_HEADER_LEN) {
+			std::array<uint8_t, RECORD_HEADER_LEN> header;
+
+			copy_from_buffer(tail + len, header.data(), header.size());
+
+			size_t record_len = header.size() + (header[6] | (header[7] << 8));
+
+			if (len + record_len > block_.size()) {
+				break;
+			}
+
+			copy_from_buffer(tail + len, &block_[len], record_len);
+			len += record_len;
+		}
+
+		if (!len) {
+			break;
+		}
+
+		tail_.store(tail + len, std::memory_order_release);
+		last_flush_ms_ = millis();
+
+		if (append(block_.data(), len)) {
+			stats_.written.add(len);
+		} else {
+			stats_.errors.add();
+		}
+	}
+}
+
+bool Capture::append(const uint8_t *data, size_t len) {
+	if (file_size_ + len > MAX_FILE_SIZE) {
+		file_remove(PREVIOUS_FILENAME);
+
+		if (!file_rename(CURRENT_FILENAME, PREVIOUS_FILENAME)
+				|| !file_append(CURRENT_FILENAME, MAGIC.data(), MAGIC.size())) {
+			logger_.err(F("Unable to replace %s"), CURRENT_FILENAME);
+			return false;
+		}
+
+		file_size_ = MAGIC.size();
+	}
+
+	if (!file_append(CURRENT_FILENAME, data, len)) {
+		logger_.err(F("Unable to write to %s"), CURRENT_FILENAME);
+		return false;
+	}
+
+	file_size_ += len;
+	return true;
+}
+
+} // namespace ggroohauga
@@ -0,0 +1,197 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/command.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace ggroohauga {
+
+void CommandQueue::clear_stats() {
+	for (auto *counter : {&stats_.submitted, &stats_.overflow, &stats_.sent,
+			&stats_.retries, &stats_.completed, &stats_.timeouts,
+			&stats_.cancelled, &stats_.max_depth}) {
+		counter->clear();
+	}
+
+	stats_.latency_us.clear();
+}
+
+CommandQueue::Reply CommandQueue::expected_reply(uint8_t opcode) {
+	const z906::Message message{Direction::ConsoleToAmplifier, opcode, false, nullptr, 0};
+
+	if (opcode == z906::query_opcode(z906::Query::Status)) {
+		return Reply::Status;
+	} else if (z906::idempotent(message)) {
+		return Reply::Any;
+	} else {
+		return Reply::Echo;
+	}
+}
+
+bool CommandQueue::accepts(const Entry &entry, const z906::Message &message) {
+	switch (entry.reply) {
+	case Reply::Echo:
+		return !message.frame && message.opcode == entry.completion.opcode;
+
+	case Reply::Status:
+		return message.frame && message.opcode == z906::STATUS_TYPE;
+
+	case Reply::Any:
+		break;
+	}
+
+	return true;
+}
+
+bool CommandQueue::submit(uint8_t opcode, Callback callback,
+		unsigned long timeout_ms, uint8_t retries) {
+	if (count_ == entries_.size()) {
+		stats_.overflow.add();
+		return false;
+	}
+
+	Entry &entry = entries_[(head_ + count_) % entries_.size()];
+
+	entry.state = State::Queued;
+	entry.reply = expected_reply(opcode);
+	entry.retries = retries;
+	entry.timeout_ms = timeout_ms;
+	entry.completion.opcode = opcode;
+	entry.completion.reply_len = 0;
+	entry.callback = std::move(callback);
+
+	count_++;
+	stats_.submitted.add();
+	stats_.max_depth.max(count_);
+	return true;
+}
+
+bool CommandQueue::next(uint8_t &opcode) {
+	unsigned long now_ms = ::millis();
+	Entry *queued = nullptr;
+
+	for (size_t i = 0; i < count_; i++) {
+		Entry &entry = entries_[(head_ + i) % entries_.size()];
+
+		if (entry.state == State::InFlight
+				&& now_ms - entry.sent_ms >= entry.timeout_ms) {
+			if (entry.retries > 0) {
+				entry.retries--;
+				entry.sent_ms = now_ms;
+				stats_.retries.add();
+				stats_.sent.add();
+				opcode = entry.completion.opcode;
+				return true;
+			}
+
+			complete(entry, Result::Timeout);
+		} else if (entry.state == State::Queued && !queued) {
+			queued = &entry;
+		}
+	}
+
+	if (queued && in_flight_ < MAX_IN_FLIGHT) {
+		queued->state = State::InFlight;
+		queued->sent_ms = now_ms;
+		queued->first_sent_us = ::micros();
+		in_flight_++;
+		stats_.sent.add();
+		opcode = queued->completion.opcode;
+		return true;
+	}
+
+	return false;
+}
+
+bool CommandQueue::reply(const z906::Message &message, const uint8_t *data, size_t len) {
+	for (size_t i = 0; i < count_; i++) {
+		Entry &entry = entries_[(head_ + i) % entries_.size()];
+
+		if (entry.state == State::InFlight && accepts(entry, message)) {
+			len = std::min(len, entry.completion.reply.size());
+			std::copy(data, data + len, entry.completion.reply.begin());
+			entry.completion.reply_len = len;
+			complete(entry, Result::Success);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CommandQueue::cancel() {
+	for (size_t i = 0; i < count_; i++) {
+		Entry &entry = entries_[(head_ + i) % entries_.size()];
+
+		if (entry.state != State::Done) {
+			complete(entry, Result::Cancelled);
+		}
+	}
+}
+
+void CommandQueue::complete(Entry &entry, Result result) {
+	if (entry.state == State::InFlight) {
+		in_flight_--;
+	}
+
+	entry.state = State::Done;
+	entry.completion.result = result;
+
+	switch (result) {
+	case Result::Success:
+		entry.completion.latency_us = ::micros() - entry.first_sent_us;
+		stats_.completed.add();
+		stats_.latency_us.add(entry.completion.latency_us);
+		break;
+
+	case Result::Timeout:
+		entry.completion.latency_us = ::micros() - entry.first_sent_us;
+		stats_.timeouts.add();
+		break;
+
+	case Result::Cancelled:
+		entry.completion.latency_us = 0;
+		stats_.cancelled.add();
+		break;
+	}
+}
+
+bool CommandQueue::pop(Callback &callback, Completion &completion) {
+	if (count_ == 0) {
+		return false;
+	}
+
+	Entry &entry = entries_[head_];
+
+	if (entry.state != State::Done) {
+		return false;
+	}
+
+	callback = std::move(entry.callback);
+	entry.callback = nullptr;
+	completion = entry.completion;
+	head_ = (head_ + 1) % entries_.size();
+	count_--;
+	return true;
+}
+
+} // namespace ggroohauga
@@ -1,6 +1,6 @@
 /*
  * ggroohauga - Alternative console and simulated amplifier interface
- * Copyright 2022  Simon Arlott
+ * Copyright 2022,2026  Simon Arlott
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -18,6 +18,8 @@
 
 #include "ggroohauga/console.h"
 
+#include <array>
+#include <cstdlib>
 #include <memory>
 #include <string>
 #include <vector>
@@ -30,6 +32,7 @@
 #include "app/console.h"
 
 using ::uuid::flash_string_vector;
+using ::uuid::read_flash_string;
 using ::uuid::console::Commands;
 using ::uuid::console::Shell;
 using LogLevel = ::uuid::log::Level;
@@ -48,6 +51,41 @@ namespace ggroohauga {
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic error "-Wunused-const-variable"
+MAKE_PSTR_WORD(amplifier)
+MAKE_PSTR_WORD(aux)
+MAKE_PSTR_WORD(block)
+MAKE_PSTR_WORD(cache)
+MAKE_PSTR_WORD(capture)
+MAKE_PSTR_WORD(clear)
+MAKE_PSTR_WORD(console)
+MAKE_PSTR_WORD(decoded)
+MAKE_PSTR_WORD(dump)
+MAKE_PSTR_WORD(fast)
+MAKE_PSTR_WORD(filter)
+MAKE_PSTR_WORD(filters)
+MAKE_PSTR_WORD(latency)
+MAKE_PSTR_WORD(limit)
+MAKE_PSTR_WORD(model)
+MAKE_PSTR_WORD(monitor)
+MAKE_PSTR_WORD(off)
+MAKE_PSTR_WORD(raw)
+MAKE_PSTR_WORD(replay)
+MAKE_PSTR_WORD(send)
+MAKE_PSTR_WORD(show)
+MAKE_PSTR_WORD(start)
+MAKE_PSTR_WORD(stats)
+MAKE_PSTR_WORD(stop)
+MAKE_PSTR_WORD(trace)
+MAKE_PSTR_WORD(window)
+MAKE_PSTR(device_optional, "[console|amplifier]")
+MAKE_PSTR(fast_optional, "[fast]")
+MAKE_PSTR(format_mandatory, "<decoded|raw>")
+MAKE_PSTR(input_mandatory, "<input|off>")
+MAKE_PSTR(level_mandatory, "<level|off>")
+MAKE_PSTR(milliseconds_mandatory, "<milliseconds>")
+MAKE_PSTR(command_mandatory, "<command>")
+MAKE_PSTR(command_optional, "[command]")
+MAKE_PSTR(opcode_optional, "[opcode]")
 #pragma GCC diagnostic pop
 
 static constexpr inline AppShell &to_app_shell(Shell &shell) {
@@ -64,8 +102,577 @@ static constexpr inline GgroohaugaShell &to_shell(Shell &shell) {
 
 #define NO_ARGUMENTS std::vector<std::string>{}
 
+static unsigned long per_call_hundredths(unsigned long bytes, unsigned long calls) {
+	return calls ? static_cast<uint64_t>(bytes) * 100 / calls : 0;
+}
+
+static void show_device_stats(Shell &shell, const Device &device) {
+	const auto &stats = device.stats();
+	const auto &commands = device.command_stats();
+	unsigned long rx_bytes = stats.rx_bytes.get();
+	unsigned long rx_calls = stats.rx_calls.get();
+	unsigned long rx_ratio = per_call_hundredths(rx_bytes, rx_calls);
+	unsigned long tx_bytes = stats.tx_bytes.get();
+	unsigned long tx_calls = stats.tx_calls.get();
+	unsigned long tx_ratio = per_call_hundredths(tx_bytes, tx_calls);
+
+	shell.printfln(F("%S:"), device.name());
+	if (Device::RX_EVENTS) {
+		shell.printfln(F("  RX events: %lu"), stats.rx_events.get());
+	}
+	shell.printfln(F("  RX: %lu bytes in %lu reads (%lu.%02lu bytes/read, max %lu), %lu overflows"),
+		rx_bytes, rx_calls, rx_ratio / 100, rx_ratio % 100, stats.rx_max.get(),
+		device.serial_stats().rx_overflows.get());
+	shell.printfln(F("  TX: %lu bytes in %lu writes (%lu.%02lu bytes/write), %lu dropped"),
+		tx_bytes, tx_calls, tx_ratio / 100, tx_ratio % 100, stats.tx_dropped.get());
+	shell.printfln(F("  Decoded: %lu commands, %lu frames, %lu malformed, %lu truncated"),
+		stats.rx_commands.get(), stats.rx_frames.get(),
+		stats.rx_malformed.get(), stats.rx_truncated.get());
+	shell.printfln(F("  Frames: %lu (%lu forwarded, %lu discarded), %lu at max length, %lu ended by idle, %lu timed out"),
+		stats.frames.get(), stats.frames_forwarded.get(),
+		stats.frames_discarded.get(), stats.frames_full.get(),
+		stats.frames_idle.get(), stats.frames_timeout.get());
+	shell.printfln(F("  Serial: %lu activations, %lu deactivations"),
+		stats.activations.get(), stats.deactivations.get());
+	shell.printfln(F("  Commands: %zu/%zu queued (max %lu), %lu submitted, %lu sent, %lu retries, %lu completed, %lu timeouts, %lu cancelled, %lu overflow"),
+		device.command_depth(), CommandQueue::SIZE, commands.max_depth.get(),
+		commands.submitted.get(), commands.sent.get(), commands.retries.get(),
+		commands.completed.get(), commands.timeouts.get(),
+		commands.cancelled.get(), commands.overflow.get());
+	shell.printfln(F("  Command latency: p50 %luµs, p99 %luµs, max %luµs"),
+		commands.latency_us.percentile(50), commands.latency_us.percentile(99),
+		commands.latency_us.max());
+
+	for (const auto *proxy : device.proxies()) {
+		const auto &proxy_stats = proxy->stats();
+
+		shell.printfln(F("  Pin %S -> %S: %lu transitions, %lu edges lost, %lu updates, %lu debounced, %lu held"),
+			proxy->src_name(), proxy->dst_name(), proxy->transitions().get(),
+			proxy->edges_lost().get(), proxy_stats.updates.get(),
+			proxy_stats.debounced.get(), proxy_stats.held.get());
+	}
+}
+
+static void show_device_latency(Shell &shell, const Device &device) {
+	const auto &latency = device.stats().latency_us;
+	const auto &boundary = device.stats().boundary_us;
+
+	shell.printfln(F("%S: %lu samples, p50 %luµs, p99 %luµs, max %luµs"),
+		device.name(), latency.count(), latency.percentile(50),
+		latency.percentile(99), latency.max());
+	shell.printfln(F("%S frame end: %lu samples, p50 %luµs, p99 %luµs, max %luµs"),
+		device.name(), boundary.count(), boundary.percentile(50),
+		boundary.percentile(99), boundary.max());
+}
+
+static void show_cache(Shell &shell, const ReplyCache &cache) {
+	const auto &stats = cache.stats();
+	unsigned long saved_bytes = stats.saved_bytes.get();
+
+	shell.printfln(F("Cache: %lums window, %lu hits, %lu misses, %lu stored, %lu invalidations"),
+		cache.window_ms(), stats.hits.get(), stats.misses.get(),
+		stats.stored.get(), stats.invalidations.get());
+	shell.printfln(F("  Saved: %lu bytes (%lums of bus time)"), saved_bytes,
+		saved_bytes * Device::CHAR_TIME_US / 1000);
+}
+
+static void show_wakeup(Shell &shell, const __FlashStringHelper *name, const Wakeup &wakeup) {
+	const auto &stats = wakeup.stats();
+	unsigned long idle = wakeup.idle_permille();
+
+	shell.printfln(F("%S: %lu.%lu%%, %lu waits, %lu wakeups, wake latency p50 %luµs, p99 %luµs, max %luµs"),
+		name, idle / 10, idle % 10, stats.waits.get(), stats.wakeups.get(),
+		stats.latency_us.percentile(50), stats.latency_us.percentile(99),
+		stats.latency_us.max());
+}
+
+static void show_publisher(Shell &shell, const StatePublisher &publisher) {
+	const auto &client = publisher.client().stats();
+	const auto &stats = publisher.stats();
+
+	shell.printfln(F("MQTT: %S, %lu connects, %lu published, %lu dropped, %lu samples, %lu changes"),
+		publisher.client().connected() ? F("connected") : F("disconnected"),
+		client.connects.get(), client.published.get(), client.dropped.get(),
+		stats.samples.get(), stats.changes.get());
+}
+
+static void show_model(Shell &shell, const AmplifierModel &model) {
+	const auto state = model.state();
+	const auto &status = state.status;
+	const auto &stats = model.stats();
+
+	shell.printfln(F("Model: %S, %S"),
+		model.enabled() ? F("enabled") : F("disabled"),
+		state.synced ? F("synced") : F("not synced"));
+	shell.printfln(F("  Power: %S, mute: %S, input: %u, effect: %u"),
+		state.power ? F("on") : F("off"), state.mute ? F("on") : F("off"),
+		static_cast<unsigned int>(status.input) + 1,
+		static_cast<unsigned int>(status.effects[static_cast<size_t>(status.input)]));
+	shell.printfln(F("  Levels: main %u, rear %u, center %u, sub %u"),
+		status.levels[static_cast<size_t>(z906::Channel::Main)],
+		status.levels[static_cast<size_t>(z906::Channel::Rear)],
+		status.levels[static_cast<size_t>(z906::Channel::Center)],
+		status.levels[static_cast<size_t>(z906::Channel::Sub)]);
+	shell.printfln(F("  Messages: %lu commands, %lu replies, %lu passed through, %lu polls, %lu updates"),
+		stats.commands.get(), stats.replies.get(), stats.pass_through.get(),
+		stats.polls.get(), stats.updates.get());
+}
+
+static void show_filters(Shell &shell, App &app) {
+	const auto &filters = app.bridge().filters;
+	int limit = app.limiter().limit();
+	int input = app.blocker().input();
+
+	if (limit == LevelLimiter::OFF) {
+		shell.println(F("Main level limit: off"));
+	} else {
+		shell.printfln(F("Main level limit: %d"), limit);
+	}
+
+	if (input == InputBlocker::OFF) {
+		shell.println(F("Blocked input: none"));
+	} else if (input == static_cast<int>(z906::Input::Aux)) {
+		shell.println(F("Blocked input: aux"));
+	} else {
+		shell.printfln(F("Blocked input: %d"), input + 1);
+	}
+
+	for (size_t i = 0; i < filters.size(); i++) {
+		const auto &stats = filters[i].stats();
+
+		shell.printfln(F("%S: %lu matched, %lu rewritten, %lu dropped, added latency p50 %luµs, p99 %luµs, max %luµs"),
+			filters[i].name(), stats.matched.get(), stats.rewritten.get(),
+			stats.dropped.get(), stats.latency_us.percentile(50),
+			stats.latency_us.percentile(99), stats.latency_us.max());
+	}
+}
+
+struct SendCommands {
+	size_t submitted = 0;
+	size_t printed = 0;
+	std::vector<CommandQueue::Completion> completions;
+};
+
+static const char *command_name(uint8_t opcode) {
+	const z906::Opcode *command = z906::lookup({Direction::ConsoleToAmplifier,
+		opcode, false, nullptr, 0});
+
+	return command ? command->name : "unknown";
+}
+
+static bool send_commands(Shell &shell, SendCommands &send) {
+	for (; send.printed < send.completions.size(); send.printed++) {
+		const auto &completion = send.completions[send.printed];
+
+		switch (completion.result) {
+		case CommandQueue::Result::Success:
+			shell.printfln(F("%s: ok (%luµs)"), command_name(completion.opcode),
+				completion.latency_us);
+			break;
+
+		case CommandQueue::Result::Timeout:
+			shell.printfln(F("%s: timeout"), command_name(completion.opcode));
+			break;
+
+		case CommandQueue::Result::Cancelled:
+			shell.printfln(F("%s: cancelled"), command_name(completion.opcode));
+			break;
+		}
+	}
+
+	return send.printed == send.submitted;
+}
+
+static bool dump_capture(Shell &shell, size_t &offset) {
+	static constexpr size_t BYTES_PER_LINE = 32;
+	static constexpr size_t LINES = 16;
+	static constexpr size_t CHARS_PER_BYTE = 2;
+	std::array<uint8_t, BYTES_PER_LINE * LINES> data;
+	size_t len = to_app(shell).capture().read(offset, data.data(), data.size());
+
+	for (size_t i = 0; i < len; i += BYTES_PER_LINE) {
+		std::array<char, CHARS_PER_BYTE * BYTES_PER_LINE + 1> message{};
+		size_t pos = 0;
+
+		for (size_t j = i; j < len && j < i + BYTES_PER_LINE; j++) {
+			snprintf_P(&message[CHARS_PER_BYTE * pos++], CHARS_PER_BYTE + 1,
+				PSTR("%02X"), data[j]);
+		}
+
+		shell.printfln(F("%08zX: %s"), offset + i, message.data());
+	}
+
+	offset += len;
+	return len < data.size();
+}
+
+static bool monitor_frames(Shell &shell, FrameMonitor &monitor, bool stop) {
+	static constexpr size_t FRAMES_PER_CALL = 4;
+	Frame frame;
+	TraceLine line;
+	unsigned long dropped;
+
+	for (size_t i = 0; i < FRAMES_PER_CALL && monitor.pop(frame); i++) {
+		size_t pos = 0;
+
+		do {
+			size_t next = format_frame(line, frame, pos);
+
+			shell.println(line.c_str());
+			if (next == pos) {
+				break;
+			}
+			pos = next;
+		} while (pos < frame.size());
+	}
+
+	dropped = monitor.new_drops();
+	if (dropped) {
+		shell.printfln(F("[%lu frames dropped]"), dropped);
+	}
+
+	if (stop) {
+		monitor.stop();
+		shell.printfln(F("%lu frames, %lu dropped"),
+			monitor.stats().frames.get(), monitor.stats().dropped.get());
+	}
+
+	return stop;
+}
+
 static inline void setup_commands(std::shared_ptr<Commands> &commands) {
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(cache), F_(window)},
+			flash_string_vector{F_(milliseconds_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		char *end;
+		unsigned long value = std::strtoul(arguments[0].c_str(), &end, 10);
+
+		if (arguments[0].empty() || *end != '\0') {
+			shell.printfln(F("Invalid window: %s"), arguments[0].c_str());
+			return;
+		}
+
+		to_app(shell).cache().window_ms(value);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(capture), F_(dump)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		size_t offset = 0;
+
+		shell.block_with([offset] (Shell &shell, bool stop) mutable -> bool {
+			return stop || dump_capture(shell, offset);
+		});
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(capture), F_(start)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		auto &app = to_app(shell);
+
+		if (app.replay().active() || !app.capture().start()) {
+			shell.println(F("Unable to start capture"));
+		}
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(capture), F_(stop)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).capture().stop();
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(filter), F_(block)},
+			flash_string_vector{F_(input_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		int input;
+
+		if (arguments[0] == read_flash_string(F_(off))) {
+			input = InputBlocker::OFF;
+		} else if (arguments[0] == read_flash_string(F_(aux))) {
+			input = static_cast<int>(z906::Input::Aux);
+		} else if (arguments[0].size() == 1 && arguments[0][0] >= '1'
+				&& arguments[0][0] < '1' + static_cast<int>(z906::Input::Aux)) {
+			input = arguments[0][0] - '1';
+		} else {
+			shell.printfln(F("Invalid input: %s"), arguments[0].c_str());
+			return;
+		}
+
+		to_app(shell).blocker().input(input);
+	},
+	[] (Shell &shell __attribute__((unused)),
+			const std::vector<std::string> &current_arguments __attribute__((unused)),
+			const std::string &next_argument __attribute__((unused))) -> std::vector<std::string> {
+		return std::vector<std::string>{"1", "2", "3", "4", "5",
+			read_flash_string(F_(aux)), read_flash_string(F_(off))};
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(filter), F_(limit)},
+			flash_string_vector{F_(level_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		int limit;
+
+		if (arguments[0] == read_flash_string(F_(off))) {
+			limit = LevelLimiter::OFF;
+		} else {
+			char *end;
+			unsigned long value = std::strtoul(arguments[0].c_str(), &end, 10);
+
+			if (arguments[0].empty() || *end != '\0'
+					|| value > AmplifierModel::MAX_LEVEL) {
+				shell.printfln(F("Invalid level: %s"), arguments[0].c_str());
+				return;
+			}
+
+			limit = value;
+		}
+
+		to_app(shell).limiter().limit(limit);
+	},
+	[] (Shell &shell __attribute__((unused)),
+			const std::vector<std::string> &current_arguments __attribute__((unused)),
+			const std::string &next_argument __attribute__((unused))) -> std::vector<std::string> {
+		return std::vector<std::string>{read_flash_string(F_(off))};
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(model), F_(start)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).model().enable(true);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(model), F_(stop)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).model().enable(false);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(monitor)},
+			flash_string_vector{F_(device_optional), F_(opcode_optional)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		bool console = true;
+		bool amplifier = true;
+		int opcode = FrameMonitor::ANY_OPCODE;
+		size_t pos = 0;
+
+		if (pos < arguments.size()) {
+			if (arguments[pos] == read_flash_string(F_(console))) {
+				amplifier = false;
+				pos++;
+			} else if (arguments[pos] == read_flash_string(F_(amplifier))) {
+				console = false;
+				pos++;
+			}
+		}
+
+		if (arguments.size() - pos > 1) {
+			if (pos == 0) {
+				shell.printfln(F("Invalid device: %s"), arguments[pos].c_str());
+			} else {
+				shell.printfln(F("Unexpected argument: %s"), arguments[pos + 1].c_str());
+			}
+			return;
+		}
+
+		if (pos < arguments.size()) {
+			char *end;
+			unsigned long value = std::strtoul(arguments[pos].c_str(), &end, 16);
+
+			if (arguments[pos].empty() || *end != '\0' || value > UINT8_MAX) {
+				shell.printfln(F("Invalid opcode: %s"), arguments[pos].c_str());
+				return;
+			}
+
+			opcode = value;
+		}
+
+		auto monitor = to_app(shell).monitor(console, amplifier, opcode);
+
+		if (!monitor) {
+			shell.println(F("Too many monitors"));
+			return;
+		}
+
+		shell.block_with([monitor] (Shell &shell, bool stop) -> bool {
+			return monitor_frames(shell, *monitor, stop);
+		});
+	},
+	[] (Shell &shell __attribute__((unused)),
+			const std::vector<std::string> &current_arguments,
+			const std::string &next_argument __attribute__((unused))) -> std::vector<std::string> {
+		if (current_arguments.empty()) {
+			return std::vector<std::string>{read_flash_string(F_(console)),
+				read_flash_string(F_(amplifier))};
+		}
+
+		return NO_ARGUMENTS;
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(replay), F_(start)},
+			flash_string_vector{F_(fast_optional)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		bool fast = false;
+
+		if (!arguments.empty()) {
+			if (arguments[0] == read_flash_string(F_(fast))) {
+				fast = true;
+			} else {
+				shell.printfln(F("Invalid timing: %s"), arguments[0].c_str());
+				return;
+			}
+		}
+
+		if (!to_app(shell).replay().start(fast)) {
+			shell.println(F("Unable to start replay"));
+		}
+	},
+	[] (Shell &shell __attribute__((unused)),
+			const std::vector<std::string> &current_arguments __attribute__((unused)),
+			const std::string &next_argument __attribute__((unused))) -> std::vector<std::string> {
+		return std::vector<std::string>{read_flash_string(F_(fast))};
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(replay), F_(stop)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).replay().stop();
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(send)},
+			flash_string_vector{F_(command_mandatory), F_(command_optional),
+				F_(command_optional), F_(command_optional), F_(command_optional),
+				F_(command_optional), F_(command_optional), F_(command_optional)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		auto send = std::make_shared<SendCommands>();
+
+		for (const auto &argument : arguments) {
+			if (!z906::find_command(argument.c_str())) {
+				shell.printfln(F("Unknown command: %s"), argument.c_str());
+				return;
+			}
+		}
+
+		for (const auto &argument : arguments) {
+			if (!to_app(shell).amplifier().submit(z906::find_command(argument.c_str())->value,
+					[send] (const CommandQueue::Completion &completion) {
+						send->completions.push_back(completion);
+					})) {
+				shell.printfln(F("Unable to send command: %s"), argument.c_str());
+				break;
+			}
+			send->submitted++;
+		}
+
+		shell.block_with([send] (Shell &shell, bool stop) -> bool {
+			return send_commands(shell, *send) || stop;
+		});
+	},
+	[] (Shell &shell __attribute__((unused)),
+			const std::vector<std::string> &current_arguments __attribute__((unused)),
+			const std::string &next_argument __attribute__((unused))) -> std::vector<std::string> {
+		std::vector<std::string> names;
+
+		z906::for_each_command([&names] (const z906::Opcode &opcode) {
+			names.emplace_back(opcode.name);
+		});
+
+		return names;
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(trace)},
+			flash_string_vector{F_(format_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		if (arguments[0] == read_flash_string(F_(decoded))) {
+			to_app(shell).trace_format(TraceFormat::Decoded);
+		} else if (arguments[0] == read_flash_string(F_(raw))) {
+			to_app(shell).trace_format(TraceFormat::Raw);
+		} else {
+			shell.printfln(F("Invalid format: %s"), arguments[0].c_str());
+		}
+	},
+	[] (Shell &shell __attribute__((unused)),
+			const std::vector<std::string> &current_arguments __attribute__((unused)),
+			const std::string &next_argument __attribute__((unused))) -> std::vector<std::string> {
+		return std::vector<std::string>{read_flash_string(F_(decoded)),
+			read_flash_string(F_(raw))};
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(clear), F_(latency)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		auto &app = to_app(shell);
+
+		app.console().clear_latency();
+		app.amplifier().clear_latency();
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(clear), F_(stats)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).clear_stats();
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(cache)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		show_cache(shell, to_app(shell).bridge().cache);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(filters)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		show_filters(shell, to_app(shell));
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(latency)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		auto &app = to_app(shell);
+
+		show_device_latency(shell, app.console());
+		show_device_latency(shell, app.amplifier());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(model)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		show_model(shell, to_app(shell).model());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(replay)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		auto &app = to_app(shell);
+		const auto &replay = app.replay();
+		const auto &stats = replay.stats();
+
+		shell.printfln(F("Replay: %S%S, %lu records (%lu frames, %lu pins)"),
+			replay.active() ? F("active") : F("inactive"),
+			replay.fast() ? F(" (fast)") : F(""),
+			stats.records.get(), stats.frames.get(), stats.pins.get());
+		shell.printfln(F("Frames: %lu matched, %lu mismatched, %lu missing, %lu extra"),
+			stats.matched.get(), stats.mismatched.get(),
+			stats.missing.get(), stats.extra.get());
+		show_device_latency(shell, app.console());
+		show_device_latency(shell, app.amplifier());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(stats)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		auto &app = to_app(shell);
+		const auto &bridge = app.bridge();
+
+		show_device_stats(shell, app.console());
+		show_device_stats(shell, app.amplifier());
+		shell.printfln(F("Frames: %zu/%zu free, %lu exhausted"),
+			bridge.frames.available(), FramePool::SIZE,
+			bridge.frames.exhausted().get());
+		shell.printfln(F("Log queue: %zu/%zu used, %lu overflow, %lu dropped"),
+			bridge.log_queue.size(), bridge.log_queue.capacity(),
+			bridge.log_overflow.get(), bridge.log_dropped.get());
+		shell.printfln(F("Capture: %S, %lu records, %zu buffered, %lu overflow, %lu bytes written, %lu errors"),
+			bridge.capture.active() ? F("active") : F("inactive"),
+			bridge.capture.stats().records.get(), bridge.capture.buffered(),
+			bridge.capture.stats().overflow.get(),
+			bridge.capture.stats().written.get(),
+			bridge.capture.stats().errors.get());
+		show_cache(shell, bridge.cache);
+		show_wakeup(shell, F("Idle"), app.wakeup());
+		if (&app.wakeup() != &app.bridge_wakeup()) {
+			show_wakeup(shell, F("Bridge idle"), app.bridge_wakeup());
+		}
 
+		if (StatePublisher::ENABLED) {
+			show_publisher(shell, app.publisher());
+		}
+	});
 }
 
 GgroohaugaShell::GgroohaugaShell(app::App &app, Stream &stream, unsigned int context, unsigned int flags)
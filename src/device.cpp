@@ -1,6 +1,6 @@
 /*
  * ggroohauga - Alternative console and simulated amplifier interface
- * Copyright 2022,2025  Simon Arlott
+ * Copyright 2022,2025-2026  Simon Arlott
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -20,38 +20,51 @@
 
 #include <Arduino.h>
 
-#include <functional>
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <utility>
 
 #include <uuid/log.h>
 
 namespace ggroohauga {
 
-Device::Device(const __FlashStringHelper *name, HardwareSerial &serial,
-		uint8_t rx_pin, uint8_t tx_pin, bool wait,
-		const std::vector<std::reference_wrapper<Proxy>> &proxies)
-		: logger_(name, uuid::log::Facility::UUCP), serial_(serial),
-		rx_pin_(rx_pin), tx_pin_(tx_pin), wait_for_other_(wait),
-		proxies_(proxies) {
+Device::Device(const __FlashStringHelper *name, Direction direction,
+		HardwareSerial &serial, uint8_t uart_num, uint8_t rx_pin, uint8_t tx_pin,
+		bool wait)
+		: name_(name), direction_(direction), logger_(name, uuid::log::Facility::UUCP),
+		serial_(serial, uart_num, rx_pin, tx_pin), wait_for_other_(wait) {
 
 }
 
-void Device::start(Device &other) {
+void Device::start(Device &other, Bridge &bridge) {
 	other_ = &other;
+	bridge_ = &bridge;
 	waiting_ = wait_for_other_;
-
-	for (auto &proxy : proxies_) {
-		proxy.get().start(this);
-	}
 }
 
 void Device::activate() {
 	if (suspend_) {
 		suspend_ = false;
 
+		stats_.activations.add();
 		logger_.trace(F("Activate serial"));
-		serial_.begin(BAUD_RATE, UART_CONFIG, rx_pin_, tx_pin_);
 		waiting_ = wait_for_other_;
+
+		if (end_serial_) {
+			/* Discard anything that was received while deactivated */
+			std::array<uint8_t, MAX_READ_LEN> data;
+
+			end_serial_ = false;
+			while (serial_.read(data.data(), data.size()) > 0);
+		} else {
+			serial_.begin(BAUD_RATE, UART_CONFIG);
+
+			if (RX_EVENTS) {
+				serial_.on_receive([this] { receive_event(); },
+					RX_TIMEOUT_SYMBOLS, RX_FIFO_FULL);
+			}
+		}
 	}
 }
 
@@ -59,71 +72,450 @@ void Device::deactivate() {
 	if (!suspend_) {
 		suspend_ = true;
 
+		stats_.deactivations.add();
 		logger_.trace(F("Deactivate serial"));
+		if (RX_EVENTS) {
+			/*
+			 * The receive event callback locks the bridge, so it can't be
+			 * removed (and the serial event task stopped) until the bridge
+			 * is unlocked by loop().
+			 */
+			end_serial_ = true;
+		} else {
+			serial_.end();
+		}
+		release_frame();
+		bridge_->filters.reset(direction_);
+		report_timer_.cancel();
+		commands_.cancel();
+		pass_through_count_ = 0;
+		passing_ = false;
+		pass_frame_ = false;
+	}
+}
+
+std::unique_lock<std::mutex> Device::lock_bridge() {
+	std::unique_lock<std::mutex> lock{bridge_->mutex, std::defer_lock};
+
+	if (Bridge::CONCURRENT) {
+		lock.lock();
+	}
+
+	return lock;
+}
+
+void Device::loop(std::unique_lock<std::mutex> &lock) {
+	if (!suspend_) {
+		receive();
+
+		uint8_t opcode;
+
+		/*
+		 * The other device forwards to the same serial port, so commands
+		 * can only be sent between its messages
+		 */
+		while (!other_->mid_message() && commands_.next(opcode)) {
+			transmit(&opcode, 1);
+		}
+
+		serial_.poll();
+	}
+
+	if (RX_EVENTS && end_serial_) {
+		end_serial_ = false;
+		lock.unlock();
+
+		serial_.on_receive(nullptr, 0, 0);
 		serial_.end();
-		buffer_.clear();
 	}
 }
 
-void Device::loop() {
-	unsigned long now_ms = millis();
-	int data = 0;
+bool Device::submit(uint8_t opcode, CommandQueue::Callback callback,
+		unsigned long timeout_ms, uint8_t retries) {
+	std::lock_guard<std::mutex> lock{bridge_->mutex};
+
+	return submit_locked(opcode, std::move(callback), timeout_ms, retries);
+}
 
-	for (auto &proxy : proxies_) {
-		proxy.get().loop();
+bool Device::submit_locked(uint8_t opcode, CommandQueue::Callback callback,
+		unsigned long timeout_ms, uint8_t retries) {
+	if (suspend_) {
+		return false;
 	}
 
+	return commands_.submit(opcode, std::move(callback), timeout_ms, retries);
+}
+
+size_t Device::command_depth() const {
+	std::lock_guard<std::mutex> lock{bridge_->mutex};
+
+	return commands_.depth();
+}
+
+void Device::complete() {
+	std::array<CommandQueue::Callback, CommandQueue::SIZE> callbacks;
+	std::array<CommandQueue::Completion, CommandQueue::SIZE> completions;
+	size_t count = 0;
+
+	{
+		std::lock_guard<std::mutex> lock{bridge_->mutex};
+
+		while (count < callbacks.size()
+				&& commands_.pop(callbacks[count], completions[count])) {
+			count++;
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (callbacks[i]) {
+			callbacks[i](completions[i]);
+		}
+	}
+}
+
+void Device::receive_event() {
+	std::lock_guard<std::mutex> lock{bridge_->mutex};
+
 	if (suspend_) {
 		return;
 	}
 
-	do {
-		int available_rx = serial_.available();
-		int available_tx = serial_.available();
+	stats_.rx_events.add();
+	receive();
+	bridge_->wakeup.notify();
+}
 
-		if (available_rx <= 0 || available_tx <= 0) {
+void Device::receive() {
+	while (true) {
+		std::array<uint8_t, MAX_READ_LEN> data;
+		size_t available = serial_.available();
+		unsigned long read_us = micros();
+
+		if (available == 0) {
+			rx_idle_us_ = read_us;
 			break;
 		}
 
-		while (available_rx-- > 0 && available_tx-- > 0) {
-			data = serial_.read();
+		size_t len = serial_.read(data.data(), std::min(available, data.size()));
 
-			if (data == -1) {
-				break;
-			}
+		if (len == 0) {
+			break;
+		}
 
-			if (!other_->buffer_.empty()) {
-				other_->report();
-			}
+		/*
+		 * The first byte can't have been received before the last time
+		 * there was no data available, or before there was time to
+		 * receive the rest of the data.
+		 */
+		unsigned long min_rx_us = read_us - len * CHAR_TIME_US;
+
+		forward(data.data(), len, (long)(min_rx_us - rx_idle_us_) > 0
+			? min_rx_us : rx_idle_us_, read_us);
+	}
+}
+
+void Device::inject(const uint8_t *data, size_t len, unsigned long first_rx_us,
+		unsigned long last_rx_us) {
+	std::lock_guard<std::mutex> lock{bridge_->mutex};
+
+	if (suspend_) {
+		return;
+	}
+
+	forward(data, len, first_rx_us, last_rx_us);
+}
 
-			if (data == 0xAA
-					&& !buffer_.empty()
-					&& buffer_[0] != 0xAA) {
+void Device::transmit(const uint8_t *data, size_t len) {
+	if (suspend_) {
+		return;
+	}
+
+	stats_.tx_dropped.add(len - serial_.write(data, len));
+}
+
+void Device::forward(const uint8_t *data, size_t len, unsigned long first_rx_us,
+		unsigned long last_rx_us) {
+	size_t start = 0;
+
+	stats_.rx_calls.add();
+	stats_.rx_bytes.add(len);
+	stats_.rx_max.max(len);
+
+	if (!other_->buffer_->empty()) {
+		other_->report();
+	}
+
+	last_rx_us_ = last_rx_us;
+
+	/*
+	 * Decide whether to forward each frame when it starts, so that a read
+	 * containing the end of one frame and the start of the next doesn't
+	 * forward (or pass through) both of them in the same way.
+	 */
+	for (size_t i = 0; i < len; i++) {
+		bool end;
+
+		if (buffer_->empty() || (data[i] == z906::FRAME_START && decoder_.idle())) {
+			relay(&data[start], i - start, first_rx_us);
+			start = i;
+
+			if (!buffer_->empty()) {
 				report();
 			}
 
-			buffer_.push_back(data);
-			if (!waiting_) {
-				other_->serial_.write(data);
-				other_->waiting_ = false;
+			forwarded_ = forwarding();
+		}
+
+		/*
+		 * Replies to queries from the other device are passed through
+		 * one message at a time, once the type of message is known
+		 */
+		if (!forwarded_ && (passing_ || pass_through_count_ > 0)) {
+			if (decoder_.idle()) {
+				relay(&data[start], i - start, first_rx_us);
+				start = i;
+
+				pass_frame_ = data[i] == z906::FRAME_START && pass_through_count_ > 0;
+				passing_ = !pass_frame_ && pass_through_count_ > 0
+					&& passes(false, data[i]);
+
+				if (pass_frame_) {
+					/* Relayed with the frame type if it's passed through */
+					start = i + 1;
+				}
+			} else if (pass_frame_) {
+				pass_frame_ = false;
+				passing_ = passes(true, data[i]);
+
+				if (passing_) {
+					relay(&z906::FRAME_START, 1, first_rx_us);
+				}
+				start = i;
 			}
 
-			if (buffer_.size() == MAX_MESSAGE_LEN) {
-				report();
-			} else if (buffer_.size() >= 4
-					&& buffer_[0] == 0xAA
-					&& buffer_.size() >= buffer_[2] + 4) {
-				report();
+			passed_ |= passing_;
+		}
+
+		/* Filters hold messages at the boundaries found by the decoder */
+		if (forwarded_ && decoder_.idle()
+				&& bridge_->filters.holds(direction_, data[i])) {
+			relay(&data[start], i - start, first_rx_us);
+			start = i;
+			bridge_->filters.start(direction_, data[i]);
+		}
+
+		if (!decode(data[i], end)) {
+			/* Answered from the cache instead of forwarding it */
+			relay(&data[start], i - start, first_rx_us);
+			start = i + 1;
+		}
+
+		if (end && bridge_->filters.holding(direction_)) {
+			relay(&data[start], i + 1 - start, first_rx_us);
+			start = i + 1;
+			bridge_->filters.end(direction_, *this);
+		}
+	}
+
+	relay(&data[start], len - start, first_rx_us);
+
+	rx_idle_ = RX_IDLE_US > 0 && decoder_.idle();
+
+	if (buffer_->empty()) {
+		report_timer_.cancel();
+	} else if (rx_idle_) {
+		report_timer_.start(bridge_->scheduler, last_rx_us + RX_IDLE_US);
+	} else {
+		report_timer_.start(bridge_->scheduler, micros() + MAX_REPORT_DELAY_MS * 1000);
+	}
+}
+
+void Device::relay(const uint8_t *data, size_t len, unsigned long first_rx_us) {
+	if (len == 0) {
+		return;
+	}
+
+	if (forwarded_ || passing_) {
+		bridge_->filters.forward(direction_, data, len, first_rx_us, *this);
+	} else {
+		bridge_->filters.reset(direction_);
+	}
+}
+
+/* Data that the filters have passed (which may have been held back earlier) */
+void Device::output(const uint8_t *data, size_t len, unsigned long first_rx_us) {
+	if (len > 0) {
+		other_->waiting_ = false;
+
+		stats_.tx_calls.add();
+		stats_.tx_bytes.add(len);
+		stats_.tx_dropped.add(len - other_->serial_.write(data, len));
+		stats_.latency_us.add(micros() - first_rx_us);
+	}
+}
+
+void Device::reply(const uint8_t *data, size_t len) {
+	transmit(data, len);
+}
+
+bool Device::decode(uint8_t value, bool &end) {
+	bool forward = true;
+
+	end = true;
+
+	if (value == z906::FRAME_START
+			&& decoder_.idle()
+			&& !buffer_->empty()) {
+		report();
+	}
+
+	if (buffer_->empty()) {
+		start_frame();
+	}
+
+	buffer_->push_back(value);
+
+	switch (decoder_.feed(value)) {
+	case z906::Decoder::Result::Incomplete:
+		end = false;
+		break;
+
+	case z906::Decoder::Result::Command: {
+			const z906::Message message{direction_, value, false, nullptr, 0};
+			const uint8_t *reply;
+			size_t reply_len;
+
+			stats_.rx_commands.add();
+			if (forwarded_ && other_->forward_
+					&& bridge_->cache.lookup(message, reply, reply_len)) {
+				transmit(reply, reply_len);
+				cached_len_++;
+				forward = false;
+			}
+			commands_.reply(message, &value, 1);
+			if (direction_ == Direction::ConsoleToAmplifier
+					&& !z906::idempotent(message)) {
+				bridge_->cache.invalidate();
+			}
+			if (listener_) {
+				z906::dispatch(*listener_, message);
 			}
+			bridge_->filters.dispatch(message);
+			break;
+		}
 
-			now_ms = millis();
-			last_millis_ = now_ms;
+	case z906::Decoder::Result::Frame:
+		stats_.rx_frames.add();
+		if (direction_ == Direction::ConsoleToAmplifier) {
+			bridge_->cache.invalidate();
+		}
+		{
+			const Frame &frame = *buffer_;
+			const z906::Message message{direction_, frame[1], true,
+				&frame.data()[z906::FRAME_HEADER_LEN], frame[2]};
+
+			commands_.reply(message, frame.data(), frame.size());
+			if (listener_) {
+				z906::dispatch(*listener_, message);
+			}
+			bridge_->filters.dispatch(message);
 		}
-	} while (data != -1);
+		report();
+		return forward;
+
+	case z906::Decoder::Result::Malformed:
+		stats_.rx_malformed.add();
+		report();
+		return forward;
 
-	if (!buffer_.empty() && now_ms - last_millis_ >= MAX_REPORT_DELAY_MS) {
+	case z906::Decoder::Result::Resync:
+		stats_.rx_malformed.add();
+		restart_frame(decoder_.restart());
+		break;
+	}
+
+	if (buffer_->full()) {
+		stats_.frames_full.add();
 		report();
 	}
+
+	return forward;
+}
+
+void Device::start_frame() {
+	frame_ = bridge_->frames.acquire();
+	buffer_ = frame_ ? frame_.get() : &local_frame_;
+	buffer_->start(direction_, millis(), micros());
+	cached_len_ = 0;
+}
+
+void Device::restart_frame(size_t pos) {
+	std::array<uint8_t, MAX_MESSAGE_LEN> data;
+	size_t len = buffer_->size() - pos;
+	z906::Decoder decoder = decoder_;
+
+	/* Report the malformed frame without the start of the next frame */
+	std::copy_n(&buffer_->data()[pos], len, data.begin());
+	buffer_->truncate(pos);
+	decoder_.reset();
+	report();
+
+	decoder_ = decoder;
+	start_frame();
+
+	for (size_t i = 0; i < len; i++) {
+		buffer_->push_back(data[i]);
+	}
+}
+
+void Device::report_timeout() {
+	if (!suspend_ && !buffer_->empty()) {
+		if (rx_idle_) {
+			stats_.frames_idle.add();
+		} else {
+			stats_.frames_timeout.add();
+		}
+		report();
+	}
+}
+
+bool Device::pass_through(uint8_t opcode) {
+	if (pass_through_count_ == pass_through_.size()) {
+		return false;
+	}
+
+	pass_through_[pass_through_count_++] = {opcode, ::millis()};
+	return true;
+}
+
+bool Device::passes(bool frame, uint8_t opcode) {
+	const uint8_t status_query = z906::query_opcode(z906::Query::Status);
+	unsigned long now_ms = ::millis();
+	size_t i = 0;
+
+	/* Oldest first, removing queries that have timed out */
+	while (i < pass_through_count_) {
+		const PassThrough &query = pass_through_[i];
+		bool expired = now_ms - query.sent_ms >= PASS_THROUGH_TIMEOUT_MS;
+		bool match = !expired && (query.opcode == status_query
+			? (frame && opcode == z906::STATUS_TYPE)
+			: (frame || opcode == query.opcode));
+
+		if (expired || match) {
+			std::copy(pass_through_.begin() + i + 1,
+				pass_through_.begin() + pass_through_count_,
+				pass_through_.begin() + i);
+			pass_through_count_--;
+		} else {
+			i++;
+		}
+
+		if (match) {
+			return true;
+		}
+	}
+
+	return false;
 }
 
 void Device::report_both() {
@@ -132,25 +524,109 @@ void Device::report_both() {
 }
 
 void Device::report() {
-	if (logger_.enabled(uuid::log::Level::TRACE)) {
-		static constexpr uint8_t BYTES_PER_LINE = 24;
-		static constexpr uint8_t CHARS_PER_BYTE = 3;
-		std::array<char, CHARS_PER_BYTE * BYTES_PER_LINE + 1> message{};
-		uint8_t pos = 0;
-
-		for (uint16_t i = 0; i < buffer_.size(); i++) {
-			snprintf_P(&message[CHARS_PER_BYTE * pos++], CHARS_PER_BYTE + 1,
-				PSTR(" %02X"), buffer_[i]);
-
-			if (pos == BYTES_PER_LINE || i == buffer_.size() - 1) {
-				logger_.trace(F("%s%S"), &message.data()[1],
-					waiting_ ? F(" [discarded]") : F(""));
-				pos = 0;
+	if (!decoder_.idle()) {
+		stats_.rx_truncated.add();
+
+		/* Forward the incomplete message, the decoder is about to be reset */
+		bridge_->filters.flush(direction_, *this);
+	}
+
+	if (!buffer_->empty()) {
+		bool discarded = (!forwarded_ && !passed_) || cached_len_ == buffer_->size();
+
+		buffer_->discarded(discarded);
+		buffer_->end(last_rx_us_);
+		stats_.boundary_us.add(micros() - last_rx_us_);
+		bridge_->capture.frame(*buffer_);
+		stats_.frames.add();
+
+		if (bridge_->observer) {
+			bridge_->observer->frame_reported(*buffer_);
+		}
+
+		for (auto *monitor : bridge_->monitors) {
+			if (monitor) {
+				monitor->frame_reported(*buffer_);
+			}
+		}
+
+		if (direction_ == Direction::AmplifierToConsole) {
+			bridge_->cache.response(*buffer_);
+		}
+
+		if (discarded) {
+			stats_.frames_discarded.add();
+		} else {
+			stats_.frames_forwarded.add();
+		}
+
+		if (logger_.enabled(uuid::log::Level::TRACE)) {
+			if (!frame_) {
+				bridge_->log_dropped.add();
+			} else if (!bridge_->log_queue.push(std::move(frame_))) {
+				bridge_->log_overflow.add();
 			}
 		}
 	}
 
-	buffer_.clear();
+	release_frame();
+}
+
+void Device::capture_pin(uint8_t pin, LogicValue value, unsigned long time_us) {
+	bridge_->capture.pin(pin, value == LogicValue::High, time_us);
+}
+
+void Device::clear_stats() {
+	for (auto *counter : {&stats_.rx_events, &stats_.rx_calls,
+			&stats_.rx_bytes, &stats_.rx_max, &stats_.rx_commands,
+			&stats_.rx_frames, &stats_.rx_malformed, &stats_.rx_truncated,
+			&stats_.tx_calls, &stats_.tx_bytes, &stats_.tx_dropped,
+			&stats_.frames,
+			&stats_.frames_forwarded, &stats_.frames_discarded,
+			&stats_.frames_full, &stats_.frames_timeout, &stats_.frames_idle,
+			&stats_.activations, &stats_.deactivations}) {
+		counter->clear();
+	}
+
+	clear_latency();
+	commands_.clear_stats();
+	serial_.clear_stats();
+}
+
+void Device::log_frame(const Frame &frame, TraceFormat format) const {
+	static constexpr uint8_t BYTES_PER_LINE = 24;
+	TraceLine line;
+	size_t pos = 0;
+
+	if (format == TraceFormat::Raw) {
+		while (pos < frame.size()) {
+			line.clear();
+			line.append_timestamp(frame.timestamp_ms());
+			line.append(':');
+			pos += line.append_hex(&frame.data()[pos],
+				std::min<size_t>(frame.size() - pos, BYTES_PER_LINE), true);
+
+			if (frame.discarded()) {
+				line.append(F(" [discarded]"));
+			}
+
+			logger_.trace(F("%s"), line.c_str());
+		}
+		return;
+	}
+
+	do {
+		pos = format_frame(line, frame, pos);
+		logger_.trace(F("%s"), line.c_str());
+	} while (pos < frame.size());
+}
+
+void Device::release_frame() {
+	passed_ = false;
+	decoder_.reset();
+	local_frame_.clear();
+	frame_.reset();
+	buffer_ = &local_frame_;
 }
 
 Monitor::Monitor(const __FlashStringHelper *name, uint8_t pin, uint8_t mode)
@@ -176,6 +652,11 @@ void Monitor::activate() {
 			logger_.trace(F("Pin %d: high-impedance"), pin_);
 		}
 		pinMode(pin_, mode_);
+
+		if (PIN_INTERRUPTS) {
+			discard_edges();
+			attachInterruptArg(pin_, edge_interrupt, this, CHANGE);
+		}
 	}
 }
 
@@ -183,11 +664,37 @@ void Monitor::deactivate() {
 	if (!suspend_) {
 		suspend_ = true;
 		value_ = LogicValue::Unknown;
+		if (PIN_INTERRUPTS) {
+			detachInterrupt(pin_);
+		}
 		logger_.trace(F("Pin %d: high-impedance"), pin_);
 		pinMode(pin_, INPUT);
 	}
 }
 
+void ARDUINO_ISR_ATTR Monitor::edge_interrupt(void *arg) {
+	Monitor *monitor = static_cast<Monitor*>(arg);
+	Edge edge{::micros(), LogicValue::Unknown};
+
+	edge.value << digitalRead(monitor->pin_);
+
+	if (!monitor->edges_.push(std::move(edge))) {
+		monitor->edge_overflow_.store(true, std::memory_order_relaxed);
+		monitor->edges_lost_.add();
+	}
+
+	if (monitor->device_) {
+		monitor->device_->wakeup().notify_from_isr();
+	}
+}
+
+void Monitor::discard_edges() {
+	Edge edge;
+
+	while (edges_.pop(edge));
+	edge_overflow_.store(false, std::memory_order_relaxed);
+}
+
 void Monitor::loop() {
 	LogicValue value;
 
@@ -195,18 +702,52 @@ void Monitor::loop() {
 		return;
 	}
 
-	value << digitalRead(pin_);
+	value = injected_.load(std::memory_order_relaxed);
+	if (value != LogicValue::Unknown) {
+		if (PIN_INTERRUPTS) {
+			discard_edges();
+		}
+		input(value, ::micros());
+	} else if (PIN_INTERRUPTS) {
+		Edge edge;
+
+		while (edges_.pop(edge)) {
+			input(edge.value, edge.time_us);
+		}
 
+		/* Read the current value if it's not known from the edges */
+		if (edge_overflow_.exchange(false, std::memory_order_relaxed)
+				|| value_ == LogicValue::Unknown) {
+			value << digitalRead(pin_);
+			input(value, ::micros());
+		}
+	} else {
+		value << digitalRead(pin_);
+		input(value, ::micros());
+	}
+}
+
+void Monitor::input(LogicValue value, unsigned long time_us) {
 	if (value != value_) {
-		changed(value);
+		transitions_.add();
+
+		if (device_) {
+			/* Report any open frames first so that the capture is in order */
+			device_->report_both();
+			device_->capture_pin(pin_, value, time_us);
+		}
+
+		changed(value, time_us);
 		value_ = value;
 	}
 }
 
-void Monitor::changed(LogicValue value) {
-	if (device_)
-		device_->report_both();
+void Monitor::clear_stats() {
+	transitions_.clear();
+	edges_lost_.clear();
+}
 
+void Monitor::changed(LogicValue value, unsigned long time_us __attribute__((unused))) {
 	logger_.trace(F("Pin %d: %S"), pin_,
 		value == LogicValue::High ? F("HIGH") : F("LOW"));
 }
@@ -215,14 +756,14 @@ Proxy::Proxy(const __FlashStringHelper *name,
 		const __FlashStringHelper *src_name, uint8_t src_pin,
 		LogicValue on_state, unsigned long debounce_on_millis,
 		unsigned long hold_off_millis, const __FlashStringHelper *dst_name,
-		uint8_t dst_pin, bool invert, std::function<void(bool)> change_func)
+		uint8_t dst_pin, bool invert)
 		: Monitor(name, src_pin,
 				on_state == LogicValue::High ? INPUT_PULLDOWN : INPUT_PULLUP),
 			src_name_(src_name), dst_name_(dst_name), src_pin_(src_pin),
 			dst_pin_(dst_pin), on_state_(on_state),
 			debounce_on_millis_(debounce_on_millis),
 			hold_off_millis_(hold_off_millis),
-			invert_(invert), change_func_(change_func) {
+			invert_(invert) {
 
 }
 
@@ -231,7 +772,7 @@ void Proxy::start(Device *device) {
 	pinMode(dst_pin_, INPUT);
 }
 
-void Proxy::activate() {
+bool Proxy::resume() {
 	Monitor::activate();
 
 	if (suspend_) {
@@ -251,14 +792,16 @@ void Proxy::activate() {
 				input_value == on_state_ ? F("on") : F("off"),
 				to_string(input_value), to_string(dst_value_));
 
-			if (input_value == on_state_ && change_func_) {
-				change_func_(true);
-			}
+			return input_value == on_state_;
 		}
 	}
+
+	return false;
 }
 
-void Proxy::deactivate() {
+bool Proxy::suspend() {
+	bool was_on = false;
+
 	if (!suspend_) {
 		LogicValue input_value = invert_ ? !dst_value_ : dst_value_;
 
@@ -269,94 +812,57 @@ void Proxy::deactivate() {
 
 		pinMode(dst_pin_, INPUT);
 
-		if (input_value == on_state_ && change_func_) {
-			change_func_(false);
-		}
-
+		was_on = input_value == on_state_;
 		dst_value_ = LogicValue::Unknown;
 	}
 
-	Monitor::deactivate();
+	return was_on;
 }
 
-void Proxy::loop() {
-	Monitor::loop();
-
-	if (hold_ && ::millis() - hold_start_millis_ >= hold_off_millis_) {
-		hold_ = false;
-	}
-
-	if (on_pending_ && !hold_
-			&& ::millis() - debounce_start_millis_ >= debounce_on_millis_) {
-		device_->report_both();
+bool Proxy::set(LogicValue value) {
+	LogicValue output_value = invert_ ? !value : value;
 
-		update(on_state_);
-		on_pending_ = false;
+	if (dst_value_ == output_value) {
+		return false;
 	}
-}
 
-void Proxy::changed(LogicValue value) {
-	device_->report_both();
-
-	if (value == on_state_) {
-		if (debounce_on_millis_ > 0) {
-			debounce_start_millis_ = ::millis();
-			on_pending_ = true;
-		} else if (hold_) {
-			on_pending_ = true;
-		}
+	bool was_on = on();
 
-		if (on_pending_) {
-			log(value);
-		} else {
-			update(value);
-		}
-	} else {
-		if (hold_off_millis_ > 0 && dst_value_ != LogicValue::Unknown) {
-			hold_ = true;
-			hold_start_millis_ = ::millis();
-		}
+	stats_.updates.add();
 
-		on_pending_ = false;
-		update(value);
+	dst_value_ = output_value;
+	if (on() != was_on) {
+		changes_.add();
 	}
+
+	return true;
 }
 
-void Proxy::update(LogicValue value) {
+void Proxy::write(LogicValue value, bool suspended) {
 	LogicValue output_value = invert_ ? !value : value;
 
-	if (dst_value_ != output_value) {
-		bool suspended = suspend_;
-
-		dst_value_ = output_value;
+	if (suspend_) {
+		logger_.trace(F("Pin %d (%S) -> %d (%S): %S (%S -> %S) [suspended]"),
+			src_pin_, src_name_, dst_pin_, dst_name_,
+			value == on_state_ ? F("on") : F("off"),
+			to_string(value), to_string(output_value));
+	} else if (!suspended) {
+		digitalWrite(dst_pin_, *output_value);
+		pinMode(dst_pin_, OUTPUT);
+
+		logger_.trace(F("Pin %d (%S) -> %d (%S): %S (%S -> %S)"),
+			src_pin_, src_name_, dst_pin_, dst_name_,
+			value == on_state_ ? F("on") : F("off"),
+			to_string(value), to_string(output_value));
+	}
+}
 
-		if (!suspend_ && value != on_state_ && change_func_) {
-			change_func_(false);
-		}
+void Proxy::clear_stats() {
+	Monitor::clear_stats();
 
-		if (suspend_) {
-			logger_.trace(F("Pin %d (%S) -> %d (%S): %S (%S -> %S) [suspended]"),
-				src_pin_, src_name_, dst_pin_, dst_name_,
-				value == on_state_ ? F("on") : F("off"),
-				to_string(value), to_string(output_value));
-		} else {
-			if (!suspended) {
-				digitalWrite(dst_pin_, *output_value);
-				pinMode(dst_pin_, OUTPUT);
-
-				logger_.trace(F("Pin %d (%S) -> %d (%S): %S (%S -> %S)"),
-					src_pin_, src_name_, dst_pin_, dst_name_,
-					value == on_state_ ? F("on") : F("off"),
-					to_string(value), to_string(output_value));
-			}
-
-			if (value == on_state_ && change_func_) {
-				change_func_(true);
-			}
-		}
-	} else {
-		log(value);
-	}
+	stats_.updates.clear();
+	stats_.debounced.clear();
+	stats_.held.clear();
 }
 
 void Proxy::log(LogicValue value) {
@@ -0,0 +1,292 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/filter.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace ggroohauga {
+
+void FilterBuffer::append(const uint8_t *data, size_t len) {
+	len = std::min(len, MAX_LEN - len_);
+	std::copy(data, data + len, data_.begin() + len_);
+	len_ += len;
+}
+
+void FilterBuffer::fix_checksums() {
+	size_t pos = 0;
+
+	while (pos < len_) {
+		size_t len = 1;
+
+		if (data_[pos] == z906::FRAME_START && pos + z906::FRAME_HEADER_LEN <= len_) {
+			len = z906::FRAME_OVERHEAD + data_[pos + 2];
+
+			if (pos + len > len_) {
+				break;
+			}
+
+			data_[pos + len - 1] = z906::checksum(&data_[pos], len);
+		}
+
+		pos += len;
+	}
+}
+
+Filter::Filter(const __FlashStringHelper *name) : name_(name) {
+}
+
+void Filter::clear_stats() {
+	for (auto *counter : {&stats_.matched, &stats_.rewritten, &stats_.dropped}) {
+		counter->clear();
+	}
+
+	stats_.latency_us.clear();
+}
+
+bool FilterPipeline::add(Filter &filter) {
+	if (count_ == filters_.size()) {
+		return false;
+	}
+
+	filters_[count_++] = &filter;
+	return true;
+}
+
+void FilterPipeline::clear_stats() {
+	for (size_t i = 0; i < count_; i++) {
+		filters_[i]->clear_stats();
+	}
+}
+
+uint32_t FilterPipeline::match(Direction direction, bool frame, uint8_t opcode) const {
+	uint32_t matched = 0;
+
+	for (size_t i = 0; i < count_; i++) {
+		if (filters_[i]->match(direction, frame, opcode)) {
+			matched |= 1UL << i;
+		}
+	}
+
+	return matched;
+}
+
+bool FilterPipeline::holds(Direction direction, uint8_t value) const {
+	/* A frame is held if any filter could match it */
+	return count_ > 0 && match(direction, value == z906::FRAME_START, value) != 0;
+}
+
+void FilterPipeline::start(Direction direction, uint8_t value) {
+	Stream &stream = streams_[static_cast<size_t>(direction)];
+
+	stream.frame = value == z906::FRAME_START;
+	stream.matched = match(direction, stream.frame, value);
+	stream.holding = stream.matched != 0;
+	stream.start_us = micros();
+	stream.message.clear();
+}
+
+void FilterPipeline::forward(Direction direction, const uint8_t *data, size_t len,
+		unsigned long first_rx_us, FilterOutput &output) {
+	Stream &stream = streams_[static_cast<size_t>(direction)];
+
+	if (!stream.holding) {
+		output.output(data, len, first_rx_us);
+		return;
+	}
+
+	if (stream.message.empty()) {
+		stream.first_rx_us = first_rx_us;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		if (stream.frame && stream.message.size() == 1) {
+			stream.matched = match(direction, true, data[i]);
+
+			if (!stream.matched) {
+				/* Release the frame start and continue from here */
+				output.output(stream.message.data(), stream.message.size(),
+					stream.first_rx_us);
+				output.output(&data[i], len - i, first_rx_us);
+				stream.holding = false;
+				stream.message.clear();
+				return;
+			}
+		}
+
+		stream.message.push_back(data[i]);
+	}
+}
+
+void FilterPipeline::end(Direction direction, FilterOutput &output) {
+	Stream &stream = streams_[static_cast<size_t>(direction)];
+
+	if (stream.holding) {
+		process(direction, stream, output);
+	}
+}
+
+void FilterPipeline::process(Direction direction, Stream &stream, FilterOutput &output) {
+	FilterBuffer &message = stream.message;
+	unsigned long complete_us = micros();
+
+	stream.holding = false;
+	reply_.clear();
+
+	if (!stream.frame || z906::valid_frame(message.data(), message.size())) {
+		for (size_t i = 0; i < count_ && !message.empty(); i++) {
+			if (!(stream.matched & (1UL << i))) {
+				continue;
+			}
+
+			Filter &filter = *filters_[i];
+			unsigned long process_us = micros();
+
+			filter.stats_.matched.add();
+
+			switch (filter.process(direction, message, reply_)) {
+			case Filter::Action::Forward:
+				break;
+
+			case Filter::Action::Rewrite:
+				message.fix_checksums();
+				filter.stats_.rewritten.add();
+				break;
+
+			case Filter::Action::Drop:
+				message.clear();
+				filter.stats_.dropped.add();
+				break;
+			}
+
+			filter.stats_.latency_us.add((complete_us - stream.start_us)
+				+ (micros() - process_us));
+		}
+	}
+
+	if (!message.empty()) {
+		output.output(message.data(), message.size(), stream.first_rx_us);
+	}
+
+	if (!reply_.empty()) {
+		reply_.fix_checksums();
+		output.reply(reply_.data(), reply_.size());
+	}
+
+	message.clear();
+}
+
+void FilterPipeline::flush(Direction direction, FilterOutput &output) {
+	Stream &stream = streams_[static_cast<size_t>(direction)];
+
+	if (stream.holding && !stream.message.empty()) {
+		output.output(stream.message.data(), stream.message.size(),
+			stream.first_rx_us);
+	}
+
+	reset(direction);
+}
+
+void FilterPipeline::reset(Direction direction) {
+	Stream &stream = streams_[static_cast<size_t>(direction)];
+
+	stream.holding = false;
+	stream.message.clear();
+}
+
+void FilterPipeline::dispatch(const z906::Message &message) {
+	for (size_t i = 0; i < count_; i++) {
+		z906::dispatch(*filters_[i], message);
+	}
+}
+
+LevelLimiter::LevelLimiter(z906::Channel channel)
+		: Filter(F("limit")), channel_(channel),
+		up_opcode_(z906::level_opcode(channel, true)) {
+}
+
+bool LevelLimiter::match(Direction direction, bool frame, uint8_t opcode) const {
+	return limit() != OFF && direction == Direction::ConsoleToAmplifier
+		&& !frame && opcode == up_opcode_;
+}
+
+Filter::Action LevelLimiter::process(Direction direction __attribute__((unused)),
+		FilterBuffer &message, FilterBuffer &reply) {
+	int limit = this->limit();
+
+	if (limit == OFF || (known_ && level_ + pending_ < limit)) {
+		if (pending_ < UINT8_MAX) {
+			pending_++;
+		}
+		return Action::Forward;
+	}
+
+	/* Acknowledge the command so that the console doesn't retry it */
+	reply.append(message.data(), message.size());
+	return Action::Drop;
+}
+
+void LevelLimiter::level(const z906::Message &message, z906::Channel channel, bool up) {
+	if (message.direction != Direction::AmplifierToConsole || channel != channel_) {
+		return;
+	}
+
+	if (up) {
+		if (pending_ > 0) {
+			pending_--;
+		}
+		if (level_ < z906::Status::MAX_LEVEL) {
+			level_++;
+		}
+	} else if (level_ > 0) {
+		level_--;
+	}
+}
+
+void LevelLimiter::status(const z906::Message &message, const z906::Status &status) {
+	if (message.direction == Direction::AmplifierToConsole) {
+		level_ = std::min(status.levels[static_cast<size_t>(channel_)],
+			z906::Status::MAX_LEVEL);
+		pending_ = 0;
+		known_ = true;
+	}
+}
+
+InputBlocker::InputBlocker() : Filter(F("block")) {
+}
+
+bool InputBlocker::match(Direction direction, bool frame, uint8_t opcode) const {
+	int input = this->input();
+
+	return direction == Direction::ConsoleToAmplifier && !frame
+		&& input != OFF
+		&& opcode == z906::input_opcode(static_cast<z906::Input>(input));
+}
+
+Filter::Action InputBlocker::process(Direction direction __attribute__((unused)),
+		FilterBuffer &message, FilterBuffer &reply) {
+	/* Acknowledge the command so that the console doesn't retry it */
+	reply.append(message.data(), message.size());
+	return Action::Drop;
+}
+
+} // namespace ggroohauga
@@ -0,0 +1,118 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef GGROOHAUGA_SIMULATION
+
+#include "ggroohauga/fixture.h"
+
+#include <Arduino.h>
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+#include "ggroohauga/z906.h"
+
+namespace ggroohauga {
+
+namespace sim {
+
+Fixture::Fixture() {
+	con_port_.connect(con_peer_);
+	amp_port_.connect(amp_peer_);
+
+	for (auto *port : {&con_port_, &con_peer_, &amp_port_, &amp_peer_}) {
+		port->pacing(false);
+	}
+
+	con_peer_.begin(Device::BAUD_RATE, Device::UART_CONFIG);
+	amp_peer_.begin(Device::BAUD_RATE, Device::UART_CONFIG);
+
+	std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+	con_.start(amp_, bridge_);
+	amp_.start(con_, bridge_);
+	con_.activate();
+	amp_.activate();
+	detect_.activate();
+}
+
+Fixture::~Fixture() {
+	{
+		std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+		detect_.deactivate();
+		con_.deactivate();
+		amp_.deactivate();
+	}
+
+	/* Finish closing the serial ports */
+	con_.loop();
+	amp_.loop();
+}
+
+void Fixture::drain() {
+	std::array<uint8_t, 256> buffer;
+	FrameHandle frame;
+
+	while (amp_peer_.read(buffer.data(), buffer.size()) > 0);
+	while (con_peer_.read(buffer.data(), buffer.size()) > 0);
+	while (bridge_.log_queue.pop(frame)) {
+		frame.reset();
+	}
+}
+
+void Fixture::run_timers() {
+	std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+	bridge_.scheduler.run();
+}
+
+std::vector<uint8_t> make_frame(uint8_t type, uint8_t length) {
+	std::vector<uint8_t> frame(z906::FRAME_OVERHEAD + length);
+
+	frame[0] = z906::FRAME_START;
+	frame[1] = type;
+	frame[2] = length;
+
+	for (size_t i = 0; i < length; i++) {
+		frame[z906::FRAME_HEADER_LEN + i] = i;
+	}
+
+	frame.back() = z906::checksum(frame.data(), frame.size());
+	return frame;
+}
+
+std::vector<uint8_t> make_garbage(size_t len, uint32_t seed) {
+	std::vector<uint8_t> data(len);
+	uint32_t state = seed;
+
+	for (auto &value : data) {
+		state = state * 1103515245 + 12345;
+		value = state >> 16;
+	}
+
+	return data;
+}
+
+} // namespace sim
+
+} // namespace ggroohauga
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/frame.h"
+
+#include <Arduino.h>
+
+#include <atomic>
+
+namespace ggroohauga {
+
+void FrameHandle::reset() {
+	if (frame_) {
+		pool_->release(frame_);
+		pool_ = nullptr;
+		frame_ = nullptr;
+	}
+}
+
+FrameHandle FramePool::acquire() {
+	uint32_t free = free_.load(std::memory_order_relaxed);
+
+	do {
+		if (!free) {
+			exhausted_.add();
+			return {};
+		}
+	} while (!free_.compare_exchange_weak(free, free & (free - 1),
+			std::memory_order_acquire, std::memory_order_relaxed));
+
+	Frame &frame = frames_[__builtin_ctz(free)];
+
+	frame.clear();
+	return {this, &frame};
+}
+
+size_t FramePool::available() const {
+	return __builtin_popcount(free_.load(std::memory_order_relaxed));
+}
+
+void FramePool::release(Frame *frame) {
+	free_.fetch_or(1UL << (frame - frames_.data()), std::memory_order_release);
+}
+
+} // namespace ggroohauga
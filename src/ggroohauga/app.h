@@ -1,6 +1,6 @@
 /*
  * ggroohauga - Alternative console and simulated amplifier interface
- * Copyright 2022,2025  Simon Arlott
+ * Copyright 2022,2025-2026  Simon Arlott
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -19,12 +19,41 @@
 #pragma once
 
 #include <Arduino.h>
-#include <Adafruit_NeoPixel.h>
+#ifndef GGROOHAUGA_SIMULATION
+# include <Adafruit_NeoPixel.h>
+#endif
 
+#include <chrono>
+#include <memory>
+#include <thread>
 #include <vector>
 
 #include "app/app.h"
+#include "benchmark.h"
 #include "device.h"
+#include "filter.h"
+#include "model.h"
+#include "monitor.h"
+#include "publisher.h"
+#include "replay.h"
+#include "sim.h"
+#include "trace.h"
+
+/*
+ * Block until there's something to do (received data, a pin change or the
+ * next deadline) instead of looping continuously, and allow the power
+ * manager to lower the CPU frequency while idle. Requires receive events
+ * and pin interrupts so that activity ends the wait. Shell input on the
+ * serial console and packets received on the Wi-Fi station interface also
+ * end the wait of the main loop.
+ *
+ * Light sleep isn't used because waking up from it takes longer than one
+ * character time and the UART would lose the first character. The minimum
+ * frequency keeps the APB clock (and therefore the UART baud rate) fixed.
+ */
+#ifndef GGROOHAUGA_IDLE_WAIT
+# define GGROOHAUGA_IDLE_WAIT 0
+#endif
 
 namespace ggroohauga {
 
@@ -39,6 +68,7 @@ private:
 	static constexpr int CON_ANNOUNCE = 41; /* no glitches on power cycle */
 	static constexpr int CON_POWER_OUT = 40; /* no glitches on power cycle */
 	static constexpr auto &con_serial_ = Serial1;
+	static constexpr int CON_UART = 1;
 
 	static constexpr int AMP_RX = 10; /* MCU TX (Amplifier RX) */
 	static constexpr int AMP_TX = 9; /* MCU RX (Amplifier TX) */
@@ -46,6 +76,7 @@ private:
 	static constexpr int AMP_ANNOUNCE = 13;
 	static constexpr int AMP_POWER_IN = 8;
 	static constexpr auto &amp_serial_ = Serial2;
+	static constexpr int AMP_UART = 2;
 #elif defined(ARDUINO_ESP_S3_DEVKITC)
 	static constexpr int LED_PIN = 38;
 
@@ -55,6 +86,7 @@ private:
 	static constexpr int CON_ANNOUNCE = 41; /* no glitches on power cycle */
 	static constexpr int CON_POWER_OUT = 40; /* no glitches on power cycle */
 	static constexpr auto &con_serial_ = Serial1;
+	static constexpr int CON_UART = 1;
 
 	static constexpr int AMP_RX = 10; /* MCU TX (Amplifier RX) */
 	static constexpr int AMP_TX = 9; /* MCU RX (Amplifier TX) */
@@ -62,6 +94,7 @@ private:
 	static constexpr int AMP_ANNOUNCE = 47;
 	static constexpr int AMP_POWER_IN = 8;
 	static constexpr auto &amp_serial_ = Serial2;
+	static constexpr int AMP_UART = 2;
 #elif defined(ARDUINO_ESP_S3_DEVKITM)
 	static constexpr int LED_PIN = 48;
 
@@ -71,6 +104,7 @@ private:
 	static constexpr int CON_ANNOUNCE = 42; /* no glitches on power cycle */
 	static constexpr int CON_POWER_OUT = 41; /* no glitches on power cycle */
 	static constexpr auto &con_serial_ = Serial1;
+	static constexpr int CON_UART = 1;
 
 	static constexpr int AMP_RX = 14; /* MCU TX (Amplifier RX) */
 	static constexpr int AMP_TX = 13; /* MCU RX (Amplifier TX) */
@@ -78,28 +112,116 @@ private:
 	static constexpr int AMP_ANNOUNCE = 26;
 	static constexpr int AMP_POWER_IN = 10;
 	static constexpr auto &amp_serial_ = Serial2;
+	static constexpr int AMP_UART = 2;
+#elif defined(GGROOHAUGA_SIMULATION)
+	static constexpr int LED_PIN = 38;
+
+	static constexpr int CON_RX = 4; /* MCU TX (Console RX) */
+	static constexpr int CON_TX = 6; /* MCU RX (Console TX) */
+	static constexpr int CON_DETECT = 17;
+	static constexpr int CON_ANNOUNCE = 41;
+	static constexpr int CON_POWER_OUT = 40;
+	static constexpr auto &con_serial_ = Serial1;
+	static constexpr int CON_UART = 1;
+
+	static constexpr int AMP_RX = 10; /* MCU TX (Amplifier RX) */
+	static constexpr int AMP_TX = 9; /* MCU RX (Amplifier TX) */
+	static constexpr int AMP_DETECT = 21;
+	static constexpr int AMP_ANNOUNCE = 13;
+	static constexpr int AMP_POWER_IN = 8;
+	static constexpr auto &amp_serial_ = Serial2;
+	static constexpr int AMP_UART = 2;
 #else
 # error "Unknown board"
 #endif
 
 public:
+	static constexpr bool IDLE_WAIT = GGROOHAUGA_IDLE_WAIT;
+
 	App();
 
 	void start() override;
 	void loop() override;
 
+	inline Device &console() { return con_; }
+	inline const Device &console() const { return con_; }
+	inline Device &amplifier() { return amp_; }
+	inline const Device &amplifier() const { return amp_; }
+	inline const Bridge &bridge() const { return bridge_; }
+	/* Main loop and bridge task (if enabled) idle waits */
+	inline const Wakeup &wakeup() const { return BRIDGE_TASK ? loop_wakeup_ : bridge_.wakeup; }
+	inline const Wakeup &bridge_wakeup() const { return bridge_.wakeup; }
+	inline Capture &capture() { return bridge_.capture; }
+	inline ReplyCache &cache() { return bridge_.cache; }
+	inline Replay &replay() { return replay_; }
+	inline AmplifierModel &model() { return model_; }
+	inline LevelLimiter &limiter() { return limiter_; }
+	inline InputBlocker &blocker() { return blocker_; }
+	inline const StatePublisher &publisher() const { return publisher_; }
+	inline TraceFormat trace_format() const { return trace_format_; }
+	inline void trace_format(TraceFormat format) { trace_format_ = format; }
+	void clear_stats();
+
+	/* Returns nullptr if there are too many monitors */
+	std::shared_ptr<FrameMonitor> monitor(bool console, bool amplifier, int opcode);
+
 private:
+	friend int benchmark::run(App &app);
+
+	static constexpr bool BRIDGE_TASK = GGROOHAUGA_BRIDGE_TASK;
+	static constexpr int BRIDGE_TASK_CORE = 0; /* Arduino loop() runs on core 1 */
+	static constexpr int BRIDGE_TASK_PRIORITY = 20; /* below Wi-Fi, above lwIP */
+	static constexpr size_t BRIDGE_TASK_STACK_SIZE = 8192;
+	static constexpr auto BRIDGE_TASK_INTERVAL = std::chrono::milliseconds{1};
+	static constexpr unsigned long BRIDGE_TASK_BLOCK_INTERVAL_MS = 100;
+	static constexpr int CAPTURE_TASK_CORE = 0; /* Away from forwarding in loop() */
+	static constexpr int CAPTURE_TASK_PRIORITY = 1;
+	static constexpr size_t CAPTURE_TASK_STACK_SIZE = 4096;
+	static constexpr auto CAPTURE_TASK_INTERVAL = std::chrono::milliseconds{100};
+	static constexpr unsigned long LED_INTERVAL_MS = 1000;
+	static constexpr unsigned long MAX_IDLE_US = 10000; /* Limits the delay for anything else */
+	static constexpr unsigned long INPUT_HOOK_INTERVAL_MS = 1000;
+	static constexpr int IDLE_MIN_CPU_FREQ_MHZ = 80;
+
+	static_assert(!IDLE_WAIT || (Device::RX_EVENTS && Monitor::PIN_INTERRUPTS),
+		"Idle wait requires receive events and pin interrupts");
+
+	void bridge_loop();
+	[[noreturn]] void bridge_task();
+	[[noreturn]] void capture_task();
+	void log_frames();
+	void idle();
+	Wakeup &loop_wakeup();
+	void hook_input();
+	void configure_power();
+	void show_led();
+	void power_changed(bool on);
 	void power_on();
 	void power_off();
 
-	Proxy con_detect_;
-	Device con_;
-	Proxy amp_detect_;
-	Proxy power_;
-	Device amp_;
-
+	using PowerCallback = ProxyCallback<App, &App::power_changed>;
+	using PowerProxy = BasicProxy<PowerCallback>;
+
+	Bridge bridge_;
+	BasicProxy<> con_detect_;
+	ProxyDevice<BasicProxy<>> con_;
+	BasicProxy<> amp_detect_;
+	PowerProxy power_;
+	ProxyDevice<BasicProxy<>, PowerProxy> amp_;
+	Replay replay_{bridge_, con_, amp_};
+	AmplifierModel model_{bridge_, con_, amp_};
+	LevelLimiter limiter_{z906::Channel::Main};
+	InputBlocker blocker_;
+	StatePublisher publisher_{bridge_, model_, power_, con_detect_, amp_detect_};
+	TraceFormat trace_format_ = TraceFormat::Decoded; /* Main loop */
+
+	Scheduler scheduler_; /* Main loop */
 	Adafruit_NeoPixel led_{1, LED_PIN, NEO_GRB | NEO_KHZ800};
-	unsigned long last_led_ms_{0};
+	MemberTimer<App, &App::show_led> led_timer_{this};
+	MemberTimer<App, &App::hook_input> input_timer_{this};
+	Wakeup loop_wakeup_; /* Main loop, if the bridge has its own task */
+	std::thread bridge_thread_;
+	std::thread capture_thread_;
 };
 
 } // namespace ggroohauga
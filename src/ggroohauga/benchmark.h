@@ -0,0 +1,50 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Run benchmarks of the forwarding hot paths instead of the application.
+ * This is only available in simulation because the benchmarks use their
+ * own serial ports and pins.
+ *
+ * Results are written to stdout as one JSON object per line, for
+ * tools/benchmark_check.py to compare with a baseline.
+ */
+#ifndef GGROOHAUGA_BENCHMARK
+# define GGROOHAUGA_BENCHMARK 0
+#endif
+
+#if GGROOHAUGA_BENCHMARK && !defined(GGROOHAUGA_SIMULATION)
+# error "Benchmarks require simulation"
+#endif
+
+namespace ggroohauga {
+
+class App;
+
+namespace benchmark {
+
+static constexpr bool ENABLED = GGROOHAUGA_BENCHMARK;
+
+/* Returns the process exit status (the application must not be started) */
+int run(App &app);
+
+} // namespace benchmark
+
+} // namespace ggroohauga
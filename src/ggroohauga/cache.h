@@ -0,0 +1,105 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "frame.h"
+#include "sim.h"
+#include "stats.h"
+#include "z906.h"
+
+namespace ggroohauga {
+
+/*
+ * Cache of amplifier replies to idempotent console queries.
+ *
+ * A decoded query from the console is remembered until the amplifier
+ * replies with a frame, and then the reply is stored with the query's
+ * opcode as the key. Repeat queries within the window are answered from
+ * the cache without forwarding them to the amplifier. If another query is
+ * received before the reply, the reply can't be matched to either of them
+ * and isn't stored.
+ *
+ * Any other command from the console or an unsolicited frame from the
+ * amplifier invalidates the whole cache.
+ */
+class ReplyCache {
+public:
+	struct Statistics {
+		Counter hits;
+		Counter misses;
+		Counter stored;
+		Counter invalidations;
+		Counter saved_bytes; /* Requests and replies not sent */
+	};
+
+	static constexpr unsigned long DEFAULT_WINDOW_MS = 250;
+
+	ReplyCache() = default;
+
+	ReplyCache(const ReplyCache&) = delete;
+	ReplyCache& operator=(const ReplyCache&) = delete;
+
+	/* Main loop */
+	inline unsigned long window_ms() const { return window_ms_.load(std::memory_order_relaxed); }
+	inline void window_ms(unsigned long window_ms) { window_ms_.store(window_ms, std::memory_order_relaxed); }
+	inline const Statistics &stats() const { return stats_; }
+	void clear_stats();
+
+	/*
+	 * Forwarding context
+	 *
+	 * Returns true and the cached reply if the console's query can be
+	 * answered from the cache.
+	 */
+	bool lookup(const z906::Message &request, const uint8_t *&reply,
+		size_t &reply_len);
+	void response(const Frame &frame);
+	void invalidate();
+
+private:
+	static constexpr size_t ENTRIES = 4;
+	static constexpr size_t MAX_REPLY_LEN = 32;
+	static constexpr unsigned long REPLY_TIMEOUT_MS = 100;
+
+	struct Entry {
+		bool valid;
+		uint8_t opcode;
+		uint8_t reply_len;
+		unsigned long time_ms;
+		std::array<uint8_t, MAX_REPLY_LEN> reply;
+	};
+
+	Entry *find(uint8_t opcode);
+
+	std::atomic<unsigned long> window_ms_{DEFAULT_WINDOW_MS};
+	std::array<Entry, ENTRIES> entries_{};
+	bool pending_ = false;
+	unsigned long pending_ms_ = 0;
+	uint8_t pending_opcode_ = 0;
+	Statistics stats_;
+};
+
+} // namespace ggroohauga
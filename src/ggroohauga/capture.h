@@ -0,0 +1,139 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include <uuid/log.h>
+
+#include "frame.h"
+#include "sim.h"
+#include "stats.h"
+
+namespace ggroohauga {
+
+/*
+ * Binary capture of bus traffic and pin changes.
+ *
+ * Records are written to a RAM ring buffer by the forwarding context and
+ * then appended to a file in large blocks by the writer (the main loop if
+ * the bridge has its own task, otherwise a low priority capture task so that
+ * flash writes don't delay forwarding). When the file
+ * reaches its maximum size it replaces the previous file, so the capture
+ * contains between 1 and 2 files worth of the most recent records.
+ *
+ * Each file starts with an 8 byte header (MAGIC) followed by records:
+ *
+ *   uint32_t time_us (little-endian)
+ *   uint8_t  type
+ *   uint8_t  flags
+ *   uint16_t length (little-endian)
+ *   uint8_t  data[length]
+ *
+ * Frame records contain the frame data. Pin records contain the pin number
+ * and have a flag for the value.
+ */
+class Capture {
+public:
+	static constexpr std::array<uint8_t, 8> MAGIC{'G', 'G', 'R', 'H', 'C', 'A', 'P', 1};
+	static constexpr size_t RECORD_HEADER_LEN = 8;
+
+	enum class RecordType : uint8_t {
+		Frame = 0,
+		Pin = 1,
+	};
+
+	static constexpr uint8_t FLAG_AMPLIFIER_TO_CONSOLE = 1 << 0; /* Frame */
+	static constexpr uint8_t FLAG_DISCARDED = 1 << 1; /* Frame */
+	static constexpr uint8_t FLAG_HIGH = 1 << 0; /* Pin */
+
+	struct Record {
+		unsigned long time_us;
+		RecordType type;
+		uint8_t flags;
+		uint16_t length;
+		std::array<uint8_t, Frame::MAX_LEN> data;
+	};
+
+	struct Statistics {
+		Counter records;
+		Counter overflow;
+		Counter written;
+		Counter errors;
+	};
+
+	Capture();
+
+	Capture(const Capture&) = delete;
+	Capture& operator=(const Capture&) = delete;
+
+	/* Main loop */
+	bool start();
+	void stop();
+
+	/* Writer */
+	void loop();
+
+	inline bool active() const { return active_.load(std::memory_order_relaxed); }
+	inline const Statistics &stats() const { return stats_; }
+	size_t buffered() const;
+	void clear_stats();
+
+	/* Returns the number of bytes read from the capture files in order */
+	size_t read(size_t offset, uint8_t *data, size_t len) const;
+
+	/* Reads the next record and advances the offset past it */
+	bool read(size_t &offset, Record &record) const;
+
+	/* Forwarding context */
+	void frame(const Frame &frame);
+	void pin(uint8_t pin, bool high, unsigned long time_us);
+
+private:
+	static constexpr size_t BUFFER_SIZE = 16384;
+	static constexpr size_t BLOCK_SIZE = 4096;
+	static constexpr unsigned long FLUSH_INTERVAL_MS = 1000;
+	static constexpr size_t MAX_FILE_SIZE = 256 * 1024;
+
+	void record(unsigned long time_us, RecordType type, uint8_t flags,
+		const uint8_t *data, size_t len);
+	size_t read_locked(size_t offset, uint8_t *data, size_t len) const;
+	void copy_from_buffer(size_t pos, uint8_t *data, size_t len) const;
+	void flush(bool all);
+	bool append(const uint8_t *data, size_t len);
+
+	uuid::log::Logger logger_;
+	mutable std::mutex mutex_; /* Files, file_size_, last_flush_ms_ and tail_ updates */
+	std::array<uint8_t, BUFFER_SIZE> buffer_;
+	std::array<uint8_t, BLOCK_SIZE> block_;
+	std::atomic<size_t> head_{0};
+	std::atomic<size_t> tail_{0};
+	std::atomic<bool> active_{false};
+	size_t file_size_ = 0;
+	unsigned long last_flush_ms_ = 0;
+	Statistics stats_;
+};
+
+} // namespace ggroohauga
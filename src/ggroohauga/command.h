@@ -0,0 +1,147 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "histogram.h"
+#include "sim.h"
+#include "stats.h"
+#include "z906.h"
+
+namespace ggroohauga {
+
+/*
+ * Queue of commands to send to the device on the other end of a serial
+ * port, with replies matched to the commands that are waiting for them.
+ *
+ * Up to MAX_IN_FLIGHT commands are sent back-to-back without waiting for
+ * the previous reply. Commands are acknowledged by an echo of the command,
+ * except for status queries which are answered by a status frame (other
+ * queries accept any reply). Commands that aren't answered before their
+ * timeout are sent again until there are no retries left.
+ *
+ * Callbacks are called from the main loop in the order that commands were
+ * submitted. Everything else must be called with the bridge locked.
+ */
+class CommandQueue {
+public:
+	enum class Result : uint8_t {
+		Success,
+		Timeout,
+		Cancelled,
+	};
+
+	static constexpr size_t SIZE = 16;
+	static constexpr size_t MAX_IN_FLIGHT = 4;
+	static constexpr size_t MAX_REPLY_LEN = z906::FRAME_OVERHEAD + z906::STATUS_LEN;
+	static constexpr unsigned long DEFAULT_TIMEOUT_MS = 200;
+	static constexpr uint8_t DEFAULT_RETRIES = 2;
+
+	struct Completion {
+		uint8_t opcode;
+		Result result;
+		unsigned long latency_us; /* From the first attempt to the reply */
+		uint8_t reply_len;
+		std::array<uint8_t, MAX_REPLY_LEN> reply;
+	};
+
+	using Callback = std::function<void(const Completion &completion)>;
+
+	struct Statistics {
+		Counter submitted;
+		Counter overflow;
+		Counter sent;
+		Counter retries;
+		Counter completed;
+		Counter timeouts;
+		Counter cancelled;
+		Counter max_depth;
+		Histogram latency_us;
+	};
+
+	CommandQueue() = default;
+
+	CommandQueue(const CommandQueue&) = delete;
+	CommandQueue& operator=(const CommandQueue&) = delete;
+
+	inline size_t depth() const { return count_; }
+	inline bool idle() const { return in_flight_ == 0; }
+	inline const Statistics &stats() const { return stats_; }
+	void clear_stats();
+
+	bool submit(uint8_t opcode, Callback callback,
+		unsigned long timeout_ms, uint8_t retries);
+
+	/* Returns true with the next opcode to be sent (or sent again) */
+	bool next(uint8_t &opcode);
+
+	/* Returns true if the received message was a reply to a command */
+	bool reply(const z906::Message &message, const uint8_t *data, size_t len);
+
+	/* Fail all commands that haven't completed */
+	void cancel();
+
+	/*
+	 * Removes the next completed command, returning false if the oldest
+	 * command hasn't completed yet.
+	 */
+	bool pop(Callback &callback, Completion &completion);
+
+private:
+	enum class State : uint8_t {
+		Queued,
+		InFlight,
+		Done,
+	};
+
+	enum class Reply : uint8_t {
+		Echo,
+		Status,
+		Any,
+	};
+
+	struct Entry {
+		State state;
+		Reply reply;
+		uint8_t retries;
+		unsigned long timeout_ms;
+		unsigned long sent_ms;
+		unsigned long first_sent_us;
+		Completion completion;
+		Callback callback;
+	};
+
+	static Reply expected_reply(uint8_t opcode);
+	static bool accepts(const Entry &entry, const z906::Message &message);
+	void complete(Entry &entry, Result result);
+
+	std::array<Entry, SIZE> entries_{};
+	size_t head_ = 0;
+	size_t count_ = 0;
+	size_t in_flight_ = 0;
+	Statistics stats_;
+};
+
+} // namespace ggroohauga
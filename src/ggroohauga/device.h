@@ -1,6 +1,6 @@
 /*
  * ggroohauga - Alternative console and simulated amplifier interface
- * Copyright 2022,2025  Simon Arlott
+ * Copyright 2022,2025-2026  Simon Arlott
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -20,12 +20,68 @@
 
 #include <Arduino.h>
 
-#include <functional>
-#include <vector>
+#include <array>
+#include <atomic>
+#include <mutex>
 
 #include <uuid/log.h>
 
 #include "app/app.h"
+#include "cache.h"
+#include "capture.h"
+#include "command.h"
+#include "filter.h"
+#include "frame.h"
+#include "histogram.h"
+#include "queue.h"
+#include "sim.h"
+#include "stats.h"
+#include "timer.h"
+#include "trace.h"
+#include "transport.h"
+#include "wakeup.h"
+#include "z906.h"
+
+/*
+ * Forward received data directly from the UART driver's receive event
+ * callback instead of waiting for the main loop to poll for it. Polling
+ * continues as a fallback.
+ *
+ * The event callback runs in the serial event task, which may need a
+ * larger stack (ARDUINO_SERIAL_EVENT_TASK_STACK_SIZE) for logging.
+ */
+#ifndef GGROOHAUGA_RX_EVENTS
+# define GGROOHAUGA_RX_EVENTS 0
+#endif
+
+/*
+ * Run the console/amplifier devices and their proxies in a separate
+ * high-priority task on the other core instead of the main loop.
+ */
+#ifndef GGROOHAUGA_BRIDGE_TASK
+# define GGROOHAUGA_BRIDGE_TASK 0
+#endif
+
+/*
+ * Capture monitored pin changes with edge interrupts instead of reading
+ * the pins every time the loop runs. Edges are timestamped when they
+ * happen so that debounce and hold-off times are measured from the real
+ * time of each change.
+ */
+#ifndef GGROOHAUGA_PIN_INTERRUPTS
+# define GGROOHAUGA_PIN_INTERRUPTS 0
+#endif
+
+/*
+ * End a frame that doesn't have a length header (i.e. commands) when the
+ * receive line has been idle for this many character times, instead of
+ * waiting for the report timeout. Frames with a length header that are
+ * still incomplete always wait for the report timeout. Set to 0 to only
+ * use the report timeout.
+ */
+#ifndef GGROOHAUGA_RX_IDLE_SYMBOLS
+# define GGROOHAUGA_RX_IDLE_SYMBOLS 3
+#endif
 
 namespace ggroohauga {
 
@@ -73,8 +129,18 @@ inline LogicValue operator!(const LogicValue &value) {
 
 class Device;
 
+class FrameObserver {
+public:
+	virtual ~FrameObserver() = default;
+
+	/* Called from the forwarding context for every completed frame */
+	virtual void frame_reported(const Frame &frame) = 0;
+};
+
 class Monitor {
 public:
+	static constexpr bool PIN_INTERRUPTS = GGROOHAUGA_PIN_INTERRUPTS;
+
 	Monitor(const __FlashStringHelper *name, uint8_t pin, uint8_t mode);
 	virtual ~Monitor() = default;
 
@@ -86,41 +152,99 @@ public:
 	virtual void deactivate();
 	virtual void loop();
 
+	inline uint8_t pin() const { return pin_; }
+	inline const Counter &transitions() const { return transitions_; }
+	inline const Counter &edges_lost() const { return edges_lost_; }
+	virtual void clear_stats();
+
+	/* Override the input value (Unknown to read the pin again) */
+	inline void inject(LogicValue value) {
+		injected_.store(value, std::memory_order_relaxed);
+	}
+
 protected:
-	virtual void changed(LogicValue value);
+	virtual void changed(LogicValue value, unsigned long time_us);
 
 	uuid::log::Logger logger_;
 	Device *device_ = nullptr;
 
 private:
+	static constexpr size_t EDGE_QUEUE_SIZE = 8;
+
+	struct Edge {
+		unsigned long time_us;
+		LogicValue value;
+	};
+
+	static void edge_interrupt(void *arg);
+	void discard_edges();
+	void input(LogicValue value, unsigned long time_us);
+
 	const uint8_t pin_;
 	const uint8_t mode_;
 	bool suspend_ = true;
 	LogicValue value_ = LogicValue::Unknown;
+	std::atomic<LogicValue> injected_{LogicValue::Unknown};
+	Counter transitions_;
+
+	/* Written by the interrupt handler */
+	SpscQueue<Edge, EDGE_QUEUE_SIZE> edges_;
+	std::atomic<bool> edge_overflow_{false};
+	Counter edges_lost_;
 };
 
+/*
+ * Proxy from an input pin to an output pin, with a debounce time before it
+ * turns on and a hold time before it can turn on again. The change callback
+ * is a compile-time type of BasicProxy.
+ */
 class Proxy: public Monitor {
 public:
-	Proxy(const __FlashStringHelper *name,
-		const __FlashStringHelper *src_name, uint8_t src_pin,
-		LogicValue on_state, unsigned long debounce_on_millis,
-		unsigned long hold_off_millis, const __FlashStringHelper *dst_name,
-		uint8_t dst_pin, bool invert,
-		std::function<void(bool)> change_func);
+	struct Statistics {
+		Counter updates;
+		Counter debounced;
+		Counter held;
+	};
 
 	Proxy(const Proxy&) = delete;
 	Proxy& operator=(const Proxy&) = delete;
 
 	void start(Device *device = nullptr) override;
-	void activate() override;
-	void deactivate() override;
-	void loop() override;
+
+	inline const __FlashStringHelper *src_name() const { return src_name_; }
+	inline const __FlashStringHelper *dst_name() const { return dst_name_; }
+	inline const Statistics &stats() const { return stats_; }
+	void clear_stats() override;
+
+	/* Forwarding context */
+	inline bool on() const {
+		return dst_value_ != LogicValue::Unknown
+			&& (invert_ ? !dst_value_ : dst_value_) == on_state_;
+	}
+
+	/*
+	 * Number of times on() has changed (never cleared), so that the main
+	 * loop can tell that it missed a short pulse
+	 */
+	inline unsigned long changes() const { return changes_.get(); }
 
 protected:
-	void changed(LogicValue value) override;
+	Proxy(const __FlashStringHelper *name,
+		const __FlashStringHelper *src_name, uint8_t src_pin,
+		LogicValue on_state, unsigned long debounce_on_millis,
+		unsigned long hold_off_millis, const __FlashStringHelper *dst_name,
+		uint8_t dst_pin, bool invert);
 
-private:
-	void update(LogicValue value);
+	/* Returns true if the output is on after activating */
+	bool resume();
+
+	/* Returns true if the output was on before deactivating */
+	bool suspend();
+
+	/* Returns false if the output value is unchanged */
+	bool set(LogicValue value);
+
+	void write(LogicValue value, bool suspended);
 	void log(LogicValue value);
 
 	const __FlashStringHelper *src_name_;
@@ -135,47 +259,475 @@ private:
 	LogicValue dst_value_ = LogicValue::Unknown;
 	bool on_pending_ = false;
 	bool hold_ = false;
-	unsigned long debounce_start_millis_;
-	unsigned long hold_start_millis_;
-	std::function<void(bool)> change_func_;
+	Counter changes_;
+	Statistics stats_;
+};
+
+/* Proxy change callback that does nothing */
+struct NoProxyCallback {
+	inline void operator()(bool on __attribute__((unused))) const {}
+};
+
+/* Proxy change callback to a member function that's bound at compile time */
+template<typename T, void (T::*Function)(bool)>
+class ProxyCallback {
+public:
+	constexpr explicit ProxyCallback(T *object) : object_(object) {}
+
+	inline void operator()(bool on) const { (object_->*Function)(on); }
+
+private:
+	T *object_;
+};
+
+template<typename Callback = NoProxyCallback>
+class BasicProxy final: public Proxy {
+public:
+	BasicProxy(const __FlashStringHelper *name,
+			const __FlashStringHelper *src_name, uint8_t src_pin,
+			LogicValue on_state, unsigned long debounce_on_millis,
+			unsigned long hold_off_millis, const __FlashStringHelper *dst_name,
+			uint8_t dst_pin, bool invert, Callback callback = Callback{})
+			: Proxy(name, src_name, src_pin, on_state, debounce_on_millis,
+				hold_off_millis, dst_name, dst_pin, invert),
+			callback_(callback) {
+	}
+
+	void activate() override;
+	void deactivate() override;
+
+protected:
+	void changed(LogicValue value, unsigned long time_us) override;
+
+private:
+	void debounce_expired();
+	void hold_expired();
+	void turn_on();
+	void update(LogicValue value);
+
+	const Callback callback_;
+	MemberTimer<BasicProxy, &BasicProxy::debounce_expired> debounce_timer_{this};
+	MemberTimer<BasicProxy, &BasicProxy::hold_expired> hold_timer_{this};
 };
 
-class Device {
+/*
+ * Proxies of a device as compile-time types, so that the device's loop
+ * calls them directly.
+ */
+template<typename... Proxies>
+class ProxyList;
+
+template<>
+class ProxyList<> {
 public:
+	static constexpr size_t SIZE = 0;
+
+	inline void start(Device *device __attribute__((unused))) {}
+	inline void loop() {}
+	inline void clear_stats() {}
+};
+
+template<typename First, typename... Rest>
+class ProxyList<First, Rest...> {
+public:
+	static constexpr size_t SIZE = 1 + sizeof...(Rest);
+
+	ProxyList(First &first, Rest&... rest) : first_(first), rest_(rest...) {}
+
+	inline void start(Device *device) {
+		first_.start(device);
+		rest_.start(device);
+	}
+
+	inline void loop() {
+		first_.loop();
+		rest_.loop();
+	}
+
+	inline void clear_stats() {
+		first_.clear_stats();
+		rest_.clear_stats();
+	}
+
+private:
+	First &first_;
+	ProxyList<Rest...> rest_;
+};
+
+/* Proxies of a device, for the shell and replay */
+class ProxyRange {
+public:
+	ProxyRange(Proxy *const *proxies, size_t size)
+		: proxies_(proxies), size_(size) {}
+
+	inline size_t size() const { return size_; }
+	inline Proxy &operator[](size_t pos) const { return *proxies_[pos]; }
+	inline Proxy *const *begin() const { return proxies_; }
+	inline Proxy *const *end() const { return proxies_ + size_; }
+
+private:
+	Proxy *const *proxies_;
+	size_t size_;
+};
+
+/* State shared by a console/amplifier pair of devices */
+struct Bridge {
+	static constexpr size_t LOG_QUEUE_SIZE = 16;
+	static constexpr size_t MAX_MONITORS = 4;
+
+	/*
+	 * The devices are only used from more than one context when they're
+	 * run in a separate task or receive data from receive events.
+	 */
+	static constexpr bool CONCURRENT = GGROOHAUGA_RX_EVENTS || GGROOHAUGA_BRIDGE_TASK;
+
+	std::mutex mutex;
+	FramePool frames;
+
+	/*
+	 * Completed frames are logged asynchronously, outside of the context
+	 * that's forwarding data.
+	 */
+	SpscQueue<FrameHandle, LOG_QUEUE_SIZE> log_queue;
+	Counter log_overflow;
+	Counter log_dropped;
+
+	Capture capture;
+	ReplyCache cache;
+	FilterPipeline filters;
+	Scheduler scheduler;
+	FrameObserver *observer = nullptr;
+
+	/* Shell sessions monitoring frames */
+	std::array<FrameObserver*, MAX_MONITORS> monitors{};
+
+	/* Notified when data is received or a pin changes */
+	Wakeup wakeup;
+};
+
+/* Serial port forwarding to the other device of a bridge (see ProxyDevice) */
+class Device: private FilterOutput {
+public:
+	struct Statistics {
+		Counter rx_events;
+		Counter rx_calls;
+		Counter rx_bytes;
+		Counter rx_max;
+		Counter rx_commands;
+		Counter rx_frames;
+		Counter rx_malformed;
+		Counter rx_truncated;
+		Counter tx_calls;
+		Counter tx_bytes;
+		Counter tx_dropped;
+		Counter frames;
+		Counter frames_forwarded;
+		Counter frames_discarded;
+		Counter frames_full;
+		Counter frames_timeout;
+		Counter frames_idle;
+		Counter activations;
+		Counter deactivations;
+
+		/* Estimated time from receiving the first byte to forwarding it (µs) */
+		Histogram latency_us;
+
+		/* Estimated time from receiving the last byte of a frame to reporting it (µs) */
+		Histogram boundary_us;
+	};
+
 	static constexpr int BAUD_RATE = 57600;
 	static constexpr int UART_CONFIG = SERIAL_8O1;
-	static constexpr size_t MAX_MESSAGE_LEN = 259;
+	static constexpr size_t MAX_MESSAGE_LEN = Frame::MAX_LEN;
+	static constexpr bool RX_EVENTS = GGROOHAUGA_RX_EVENTS;
+	static constexpr bool UART_FIFO = GGROOHAUGA_UART_FIFO;
+
+	static_assert(!RX_EVENTS || !UART_FIFO,
+		"Receive events aren't supported when using the UART FIFOs directly");
+	static constexpr unsigned long CHAR_TIME_US = (11 * 1000000UL + BAUD_RATE - 1) / BAUD_RATE; /* 8O1 */
+	static constexpr unsigned long RX_IDLE_US = GGROOHAUGA_RX_IDLE_SYMBOLS * CHAR_TIME_US;
+	static constexpr unsigned long MAX_REPORT_DELAY_MS = 45;
 
-	Device(const __FlashStringHelper *name, HardwareSerial &serial,
-		uint8_t rx_pin, uint8_t tx_pin, bool wait,
-		const std::vector<std::reference_wrapper<Proxy>> &proxies);
+	Device(const __FlashStringHelper *name, Direction direction,
+		HardwareSerial &serial, uint8_t uart_num,
+		uint8_t rx_pin, uint8_t tx_pin, bool wait);
 
 	Device(const Device&) = delete;
 	Device& operator=(const Device&) = delete;
 
-	void start(Device &other);
 	void activate();
 	void deactivate();
-	void loop();
 	void report_both();
 
-private:
-	static constexpr unsigned long MAX_REPORT_DELAY_MS = 45;
+	/*
+	 * Process data as if it had been received from the serial port, so
+	 * frames end in the same way (by decoding or timeout)
+	 */
+	void inject(const uint8_t *data, size_t len, unsigned long first_rx_us,
+		unsigned long last_rx_us);
+
+	/*
+	 * Send data from this device (the bridge must be locked). Received
+	 * data is only forwarded to the other device when forwarding is
+	 * enabled or it's a reply to a query that's being passed through.
+	 */
+	void transmit(const uint8_t *data, size_t len);
+	inline void forwarding(bool enable) { forward_ = enable; }
+
+	/*
+	 * Pass the reply to a query from the other device through to it while
+	 * forwarding is disabled (the bridge must be locked). The reply is the
+	 * next message that matches the query: a status frame for a status
+	 * query, otherwise any frame or an echo of the query. Returns false if
+	 * there are too many queries waiting for a reply.
+	 */
+	bool pass_through(uint8_t opcode);
+
+	/*
+	 * Queue a command to send to the other end of this device's serial
+	 * port. Received data isn't forwarded while there are commands waiting
+	 * for a reply.
+	 */
+	bool submit(uint8_t opcode, CommandQueue::Callback callback,
+		unsigned long timeout_ms = CommandQueue::DEFAULT_TIMEOUT_MS,
+		uint8_t retries = CommandQueue::DEFAULT_RETRIES);
+
+	/* Queue a command with the bridge already locked */
+	bool submit_locked(uint8_t opcode, CommandQueue::Callback callback,
+		unsigned long timeout_ms = CommandQueue::DEFAULT_TIMEOUT_MS,
+		uint8_t retries = CommandQueue::DEFAULT_RETRIES);
+
+	/* Call the callbacks for completed commands (main loop) */
+	void complete();
+
+	void capture_pin(uint8_t pin, LogicValue value, unsigned long time_us);
+	void log_frame(const Frame &frame, TraceFormat format) const;
+
+	inline const __FlashStringHelper *name() const { return name_; }
+	inline const Statistics &stats() const { return stats_; }
+	virtual ProxyRange proxies() const = 0;
+	inline Scheduler &scheduler() { return bridge_->scheduler; }
+	inline Wakeup &wakeup() { return bridge_->wakeup; }
+	inline const CommandQueue::Statistics &command_stats() const { return commands_.stats(); }
+	inline const Transport::Statistics &serial_stats() const { return serial_.stats(); }
+	size_t command_depth() const;
+	inline void clear_latency() {
+		stats_.latency_us.clear();
+		stats_.boundary_us.clear();
+	}
+	inline void listener(z906::Listener *listener) { listener_ = listener; }
+
+protected:
+	void start(Device &other, Bridge &bridge);
+
+	/* Locks the bridge if it's used from more than one context */
+	std::unique_lock<std::mutex> lock_bridge();
+
+	/* Called with the lock from lock_bridge(), which may be released */
+	void loop(std::unique_lock<std::mutex> &lock);
 
+	void clear_stats();
+
+private:
+	static constexpr size_t MAX_READ_LEN = 128;
+	static constexpr size_t MAX_PASS_THROUGH = 4;
+	static constexpr unsigned long PASS_THROUGH_TIMEOUT_MS = CommandQueue::DEFAULT_TIMEOUT_MS;
+	static constexpr uint8_t RX_TIMEOUT_SYMBOLS = 1;
+	static constexpr uint8_t RX_FIFO_FULL = 16;
+
+	struct PassThrough {
+		uint8_t opcode;
+		unsigned long sent_ms;
+	};
+
+	void output(const uint8_t *data, size_t len, unsigned long first_rx_us) override;
+	void reply(const uint8_t *data, size_t len) override;
+	void receive_event();
+	void receive();
+	void forward(const uint8_t *data, size_t len, unsigned long first_rx_us,
+		unsigned long last_rx_us);
+	void relay(const uint8_t *data, size_t len, unsigned long first_rx_us);
+	/*
+	 * Returns false if the value was answered from the cache instead. Sets
+	 * end if the value ended a message (which may be malformed).
+	 */
+	bool decode(uint8_t value, bool &end);
+	inline bool forwarding() const {
+		return !waiting_ && forward_ && commands_.idle();
+	}
+	/* Returns true if the message is the reply to a query being passed through */
+	bool passes(bool frame, uint8_t opcode);
+	/* Part of a message has been forwarded and the rest of it must follow */
+	inline bool mid_message() const {
+		return (forwarded_ || passing_ || pass_frame_) && !decoder_.idle();
+	}
+	void start_frame();
+	void restart_frame(size_t pos);
+	void report_timeout();
 	void report();
+	void release_frame();
 
+	const __FlashStringHelper *name_;
+	const Direction direction_;
 	uuid::log::Logger logger_;
-	HardwareSerial &serial_;
-	const uint8_t rx_pin_;
-	const uint8_t tx_pin_;
+	Transport serial_;
 	const bool wait_for_other_;
-	std::vector<std::reference_wrapper<Proxy>> proxies_;
 	Device *other_;
+	Bridge *bridge_;
 	bool waiting_;
 
 	bool suspend_ = true;
-	std::vector<uint8_t> buffer_;
-	unsigned long last_millis_;
+	bool end_serial_ = false; /* Deactivated but the serial port is still open */
+	bool forward_ = true;
+	bool forwarded_ = false; /* Current frame is being forwarded */
+	size_t cached_len_ = 0; /* Commands in the current frame answered from the cache */
+	std::array<PassThrough, MAX_PASS_THROUGH> pass_through_{};
+	size_t pass_through_count_ = 0;
+	bool passing_ = false; /* Current message is passed through */
+	bool passed_ = false; /* Part of the current frame was passed through */
+	bool pass_frame_ = false; /* Waiting for the type of a frame that may be passed through */
+	z906::Decoder decoder_;
+	z906::Listener *listener_ = nullptr;
+	CommandQueue commands_;
+	FrameHandle frame_;
+	Frame local_frame_;
+	Frame *buffer_ = &local_frame_;
+	MemberTimer<Device, &Device::report_timeout> report_timer_{this};
+	unsigned long rx_idle_us_ = 0;
+	unsigned long last_rx_us_ = 0;
+	bool rx_idle_ = false; /* Report timer is waiting for the line to be idle */
+	Statistics stats_;
 };
 
+/* Device with its proxies as compile-time types */
+template<typename... Proxies>
+class ProxyDevice final: public Device {
+public:
+	ProxyDevice(const __FlashStringHelper *name, Direction direction,
+			HardwareSerial &serial, uint8_t uart_num,
+			uint8_t rx_pin, uint8_t tx_pin, bool wait, Proxies&... proxies)
+			: Device(name, direction, serial, uart_num, rx_pin, tx_pin, wait),
+			proxies_(proxies...), pointers_{{&proxies...}} {
+	}
+
+	void start(Device &other, Bridge &bridge) {
+		Device::start(other, bridge);
+		proxies_.start(this);
+	}
+
+	void loop() {
+		auto lock = lock_bridge();
+
+		proxies_.loop();
+		Device::loop(lock);
+	}
+
+	void clear_stats() {
+		Device::clear_stats();
+		proxies_.clear_stats();
+	}
+
+	ProxyRange proxies() const override {
+		return ProxyRange{pointers_.data(), pointers_.size()};
+	}
+
+private:
+	ProxyList<Proxies...> proxies_;
+	const std::array<Proxy*, sizeof...(Proxies)> pointers_;
+};
+
+template<typename Callback>
+void BasicProxy<Callback>::activate() {
+	if (resume()) {
+		callback_(true);
+	}
+}
+
+template<typename Callback>
+void BasicProxy<Callback>::deactivate() {
+	if (suspend()) {
+		callback_(false);
+	}
+
+	Monitor::deactivate();
+}
+
+template<typename Callback>
+void BasicProxy<Callback>::debounce_expired() {
+	if (on_pending_ && !hold_) {
+		turn_on();
+	}
+}
+
+template<typename Callback>
+void BasicProxy<Callback>::hold_expired() {
+	hold_ = false;
+
+	if (on_pending_ && !debounce_timer_.armed()) {
+		turn_on();
+	}
+}
+
+template<typename Callback>
+void BasicProxy<Callback>::turn_on() {
+	device_->report_both();
+
+	update(on_state_);
+	on_pending_ = false;
+}
+
+template<typename Callback>
+void BasicProxy<Callback>::changed(LogicValue value, unsigned long time_us) {
+	if (value == on_state_) {
+		if (debounce_on_millis_ > 0) {
+			debounce_timer_.start(device_->scheduler(),
+				time_us + debounce_on_millis_ * 1000);
+			on_pending_ = true;
+		} else if (hold_) {
+			on_pending_ = true;
+		}
+
+		if (on_pending_) {
+			log(value);
+		} else {
+			update(value);
+		}
+	} else {
+		if (hold_off_millis_ > 0 && dst_value_ != LogicValue::Unknown) {
+			stats_.held.add();
+			hold_ = true;
+			hold_timer_.start(device_->scheduler(),
+				time_us + hold_off_millis_ * 1000);
+		}
+
+		if (on_pending_) {
+			stats_.debounced.add();
+		}
+
+		debounce_timer_.cancel();
+		on_pending_ = false;
+		update(value);
+	}
+}
+
+template<typename Callback>
+void BasicProxy<Callback>::update(LogicValue value) {
+	bool suspended = suspend_;
+
+	if (!set(value)) {
+		log(value);
+		return;
+	}
+
+	if (!suspend_ && value != on_state_) {
+		callback_(false);
+	}
+
+	write(value, suspended);
+
+	if (!suspend_ && value == on_state_) {
+		callback_(true);
+	}
+}
+
 } // namespace ggroohauga
@@ -0,0 +1,271 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "frame.h"
+#include "histogram.h"
+#include "sim.h"
+#include "stats.h"
+#include "z906.h"
+
+namespace ggroohauga {
+
+/* One or more complete messages */
+class FilterBuffer {
+public:
+	static constexpr size_t MAX_LEN = Frame::MAX_LEN;
+
+	FilterBuffer() = default;
+
+	FilterBuffer(const FilterBuffer&) = delete;
+	FilterBuffer& operator=(const FilterBuffer&) = delete;
+
+	inline uint8_t *data() { return data_.data(); }
+	inline const uint8_t *data() const { return data_.data(); }
+	inline size_t size() const { return len_; }
+	inline bool empty() const { return len_ == 0; }
+	inline uint8_t &operator[](size_t pos) { return data_[pos]; }
+	inline uint8_t operator[](size_t pos) const { return data_[pos]; }
+
+	inline void push_back(uint8_t value) {
+		if (len_ < MAX_LEN) {
+			data_[len_++] = value;
+		}
+	}
+
+	void append(const uint8_t *data, size_t len);
+	inline void clear() { len_ = 0; }
+
+	/* Recalculate the checksum of every frame */
+	void fix_checksums();
+
+private:
+	std::array<uint8_t, MAX_LEN> data_;
+	uint16_t len_ = 0;
+};
+
+/*
+ * Stage of the filter pipeline. Filters see every decoded message as a
+ * listener but only hold up forwarding of the messages that they match.
+ */
+class Filter: public z906::Listener {
+public:
+	enum class Action : uint8_t {
+		Forward,
+		Rewrite, /* Frame checksums are recalculated afterwards */
+		Drop,
+	};
+
+	struct Statistics {
+		Counter matched;
+		Counter rewritten;
+		Counter dropped;
+
+		/* Time that forwarding was delayed by this filter (µs) */
+		Histogram latency_us;
+	};
+
+	Filter(const __FlashStringHelper *name);
+	virtual ~Filter() = default;
+
+	Filter(const Filter&) = delete;
+	Filter& operator=(const Filter&) = delete;
+
+	inline const __FlashStringHelper *name() const { return name_; }
+	inline const Statistics &stats() const { return stats_; }
+	void clear_stats();
+
+	/*
+	 * Forwarding context
+	 *
+	 * Returns true if the message with this opcode (or frame type) must be
+	 * complete before any of it is forwarded. Before the type of a frame
+	 * has been received this is called with the frame start as the opcode
+	 * and must return true if any type of frame could match.
+	 */
+	virtual bool match(Direction direction, bool frame, uint8_t opcode) const = 0;
+
+	/*
+	 * Process a matched message. It can be modified or extended with more
+	 * messages (Rewrite) or removed (Drop). Messages added to the reply
+	 * are sent back to the sender.
+	 */
+	virtual Action process(Direction direction, FilterBuffer &message,
+		FilterBuffer &reply) = 0;
+
+private:
+	friend class FilterPipeline;
+
+	const __FlashStringHelper *name_;
+	Statistics stats_;
+};
+
+/* Destination of filtered data */
+class FilterOutput {
+public:
+	virtual ~FilterOutput() = default;
+
+	/* Send data to the receiver, which started being received at first_rx_us */
+	virtual void output(const uint8_t *data, size_t len, unsigned long first_rx_us) = 0;
+
+	/* Send data back to the sender */
+	virtual void reply(const uint8_t *data, size_t len) = 0;
+};
+
+/*
+ * Filters applied to data forwarded between the console and amplifier.
+ *
+ * Data is forwarded as soon as it's received (cut-through) unless a
+ * filter matches the message that it's part of. A frame start is held
+ * until the frame type has been received if any filter could match a
+ * frame, and released immediately if none of them do.
+ *
+ * The pipeline doesn't decode messages itself. The device tells it where
+ * a message to be held starts and when it ends, from its decoder, so that
+ * the two can't disagree about message boundaries after a resync or a
+ * truncated frame.
+ *
+ * Matched messages are held until they're complete, then passed to each
+ * filter that matched them in order before being forwarded. Frames that
+ * are malformed are forwarded without being processed.
+ */
+class FilterPipeline {
+public:
+	static constexpr size_t MAX_FILTERS = 4;
+
+	FilterPipeline() = default;
+
+	FilterPipeline(const FilterPipeline&) = delete;
+	FilterPipeline& operator=(const FilterPipeline&) = delete;
+
+	/* Setup (before forwarding starts) */
+	bool add(Filter &filter);
+
+	inline size_t size() const { return count_; }
+	inline const Filter &operator[](size_t pos) const { return *filters_[pos]; }
+	void clear_stats();
+
+	/*
+	 * Forwarding context
+	 *
+	 * Returns true if a message starting with this value must be held (the
+	 * data before it has to be forwarded first, then start() called).
+	 */
+	bool holds(Direction direction, uint8_t value) const;
+	void start(Direction direction, uint8_t value);
+	inline bool holding(Direction direction) const {
+		return streams_[static_cast<size_t>(direction)].holding;
+	}
+
+	/* Data from the current message, or between messages that aren't held */
+	void forward(Direction direction, const uint8_t *data, size_t len,
+		unsigned long first_rx_us, FilterOutput &output);
+
+	/* The decoder has reached the end of the held message (which may be malformed) */
+	void end(Direction direction, FilterOutput &output);
+
+	/* Forward a held incomplete message */
+	void flush(Direction direction, FilterOutput &output);
+
+	/* Discard a held incomplete message (the data isn't being forwarded) */
+	void reset(Direction direction);
+
+	void dispatch(const z906::Message &message);
+
+private:
+	struct Stream {
+		bool holding = false;
+		bool frame = false;
+		uint32_t matched = 0;
+		unsigned long start_us = 0;
+		unsigned long first_rx_us = 0;
+		FilterBuffer message;
+	};
+
+	uint32_t match(Direction direction, bool frame, uint8_t opcode) const;
+	void process(Direction direction, Stream &stream, FilterOutput &output);
+
+	std::array<Filter*, MAX_FILTERS> filters_{};
+	size_t count_ = 0;
+	std::array<Stream, 2> streams_;
+	FilterBuffer reply_;
+};
+
+/*
+ * Drops console commands that would increase a channel's level above the
+ * limit. The level is tracked from the amplifier's status frames and its
+ * acknowledgements of level changes, and from level increases that have
+ * been forwarded but not yet acknowledged. Increases are dropped until the
+ * level is known.
+ */
+class LevelLimiter: public Filter {
+public:
+	static constexpr int OFF = -1;
+
+	LevelLimiter(z906::Channel channel);
+
+	/* Main loop */
+	inline int limit() const { return limit_.load(std::memory_order_relaxed); }
+	inline void limit(int limit) { limit_.store(limit, std::memory_order_relaxed); }
+
+	/* Forwarding context */
+	bool match(Direction direction, bool frame, uint8_t opcode) const override;
+	Action process(Direction direction, FilterBuffer &message,
+		FilterBuffer &reply) override;
+
+	void level(const z906::Message &message, z906::Channel channel, bool up) override;
+	void status(const z906::Message &message, const z906::Status &status) override;
+
+private:
+	const z906::Channel channel_;
+	const uint8_t up_opcode_;
+	std::atomic<int> limit_{OFF};
+	bool known_ = false;
+	uint8_t level_ = 0;
+	uint8_t pending_ = 0;
+};
+
+/* Drops console commands that select a blocked input */
+class InputBlocker: public Filter {
+public:
+	static constexpr int OFF = -1;
+
+	InputBlocker();
+
+	/* Main loop */
+	inline int input() const { return input_.load(std::memory_order_relaxed); }
+	inline void input(int input) { input_.store(input, std::memory_order_relaxed); }
+
+	/* Forwarding context */
+	bool match(Direction direction, bool frame, uint8_t opcode) const override;
+	Action process(Direction direction, FilterBuffer &message,
+		FilterBuffer &reply) override;
+
+private:
+	std::atomic<int> input_{OFF};
+};
+
+} // namespace ggroohauga
@@ -0,0 +1,98 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#ifdef GGROOHAUGA_SIMULATION
+
+#include <Arduino.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <uuid/log.h>
+
+#include "device.h"
+#include "sim.h"
+
+namespace ggroohauga {
+
+namespace sim {
+
+/*
+ * Pair of devices with their own serial ports and pins, independent of the
+ * application, for benchmarks and tests.
+ */
+class Fixture {
+public:
+	/* Unused by App */
+	static constexpr uint8_t DETECT_PIN = 45;
+	static constexpr uint8_t ANNOUNCE_PIN = 46;
+
+	Fixture();
+	~Fixture();
+
+	Fixture(const Fixture&) = delete;
+	Fixture& operator=(const Fixture&) = delete;
+
+	/* Discard everything that was forwarded or queued for logging */
+	void drain();
+
+	void run_timers();
+
+	HardwareSerial con_port_;
+	HardwareSerial con_peer_;
+	HardwareSerial amp_port_;
+	HardwareSerial amp_peer_;
+	Bridge bridge_;
+	BasicProxy<> detect_{F("fixture"), F("detect"), DETECT_PIN, LogicValue::Low,
+		5, 5, F("announce"), ANNOUNCE_PIN, false};
+	ProxyDevice<BasicProxy<>> con_{F("console"), Direction::ConsoleToAmplifier,
+		con_port_, 1, 0, 0, false, detect_};
+	ProxyDevice<> amp_{F("amplifier"), Direction::AmplifierToConsole, amp_port_, 2,
+		0, 0, false};
+};
+
+/* Enables TRACE logging (so that frames are queued for logging) */
+class TraceHandler: public uuid::log::Handler {
+public:
+	TraceHandler() {
+		uuid::log::Logger::register_handler(this, uuid::log::Level::TRACE);
+	}
+
+	~TraceHandler() override {
+		uuid::log::Logger::unregister_handler(this);
+	}
+
+	void operator<<(std::shared_ptr<uuid::log::Message> message __attribute__((unused))) override {}
+};
+
+/* Valid frame with a payload of incrementing values */
+std::vector<uint8_t> make_frame(uint8_t type, uint8_t length);
+
+/* Pseudo-random data that's the same every time */
+std::vector<uint8_t> make_garbage(size_t len, uint32_t seed = 0x5EED);
+
+} // namespace sim
+
+} // namespace ggroohauga
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "stats.h"
+
+namespace ggroohauga {
+
+enum class Direction : uint8_t {
+	ConsoleToAmplifier = 0,
+	AmplifierToConsole = 1,
+};
+
+class Frame {
+public:
+	static constexpr size_t MAX_LEN = 259;
+
+	Frame() = default;
+
+	Frame(const Frame&) = delete;
+	Frame& operator=(const Frame&) = delete;
+
+	inline const uint8_t *data() const { return data_.data(); }
+	inline size_t size() const { return len_; }
+	inline bool empty() const { return len_ == 0; }
+	inline bool full() const { return len_ == MAX_LEN; }
+	inline uint8_t operator[](size_t pos) const { return data_[pos]; }
+	inline Direction direction() const { return direction_; }
+	inline unsigned long timestamp_ms() const { return timestamp_ms_; }
+	inline unsigned long timestamp_us() const { return timestamp_us_; }
+	inline unsigned long end_us() const { return end_us_; }
+	inline bool discarded() const { return discarded_; }
+
+	inline void start(Direction direction, unsigned long timestamp_ms,
+			unsigned long timestamp_us) {
+		direction_ = direction;
+		timestamp_ms_ = timestamp_ms;
+		timestamp_us_ = timestamp_us;
+		end_us_ = timestamp_us;
+		discarded_ = false;
+		len_ = 0;
+	}
+
+	inline void discarded(bool discarded) { discarded_ = discarded; }
+	inline void end(unsigned long end_us) { end_us_ = end_us; }
+
+	inline void push_back(uint8_t value) {
+		if (len_ < MAX_LEN) {
+			data_[len_++] = value;
+		}
+	}
+
+	inline void truncate(size_t len) {
+		if (len < len_) {
+			len_ = len;
+		}
+	}
+
+	inline void clear() { len_ = 0; }
+
+private:
+	std::array<uint8_t, MAX_LEN> data_;
+	uint16_t len_ = 0;
+	Direction direction_ = Direction::ConsoleToAmplifier;
+	bool discarded_ = false;
+	unsigned long timestamp_ms_ = 0;
+	unsigned long timestamp_us_ = 0;
+	unsigned long end_us_ = 0; /* Estimated time the last byte was received */
+};
+
+class FramePool;
+
+/*
+ * Exclusive ownership of a frame from a pool. The frame is returned to the
+ * pool when the handle is reset or destroyed.
+ */
+class FrameHandle {
+public:
+	FrameHandle() = default;
+	~FrameHandle() { reset(); }
+
+	FrameHandle(const FrameHandle&) = delete;
+	FrameHandle& operator=(const FrameHandle&) = delete;
+
+	FrameHandle(FrameHandle &&other) : pool_(other.pool_), frame_(other.frame_) {
+		other.pool_ = nullptr;
+		other.frame_ = nullptr;
+	}
+
+	FrameHandle& operator=(FrameHandle &&other) {
+		if (this != &other) {
+			reset();
+			pool_ = other.pool_;
+			frame_ = other.frame_;
+			other.pool_ = nullptr;
+			other.frame_ = nullptr;
+		}
+		return *this;
+	}
+
+	inline explicit operator bool() const { return frame_ != nullptr; }
+	inline Frame& operator*() const { return *frame_; }
+	inline Frame* operator->() const { return frame_; }
+	inline Frame* get() const { return frame_; }
+
+	void reset();
+
+private:
+	friend FramePool;
+
+	FrameHandle(FramePool *pool, Frame *frame) : pool_(pool), frame_(frame) {}
+
+	FramePool *pool_ = nullptr;
+	Frame *frame_ = nullptr;
+};
+
+/*
+ * Preallocated frames that can be acquired and released from any context
+ * without locking or heap allocation.
+ */
+class FramePool {
+public:
+	static constexpr size_t SIZE = 16;
+
+	FramePool() = default;
+
+	FramePool(const FramePool&) = delete;
+	FramePool& operator=(const FramePool&) = delete;
+
+	/* Returns an empty handle if there are no free frames */
+	FrameHandle acquire();
+
+	size_t available() const;
+	inline const SharedCounter &exhausted() const { return exhausted_; }
+	inline void clear_stats() { exhausted_.clear(); }
+
+private:
+	friend FrameHandle;
+
+	static_assert(SIZE <= 32, "Free frames must fit in a 32-bit mask");
+
+	void release(Frame *frame);
+
+	std::array<Frame, SIZE> frames_;
+	std::atomic<uint32_t> free_{(SIZE == 32) ? UINT32_MAX : ((1UL << SIZE) - 1)};
+	SharedCounter exhausted_;
+};
+
+} // namespace ggroohauga
@@ -0,0 +1,91 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "stats.h"
+
+namespace ggroohauga {
+
+/*
+ * Histogram with power of 2 sized buckets. Bucket 0 counts values of 0 and
+ * bucket n counts values from 2^(n-1) to 2^n - 1. The last bucket also
+ * counts all larger values.
+ */
+class Histogram {
+public:
+	static constexpr size_t BUCKETS = 24;
+
+	Histogram() = default;
+
+	Histogram(const Histogram&) = delete;
+	Histogram& operator=(const Histogram&) = delete;
+
+	inline void add(unsigned long value) {
+		size_t bucket = value ? (sizeof(value) * 8 - __builtin_clzl(value)) : 0;
+
+		buckets_[std::min(bucket, BUCKETS - 1)].add();
+		count_.add();
+		max_.max(value);
+	}
+
+	inline unsigned long count() const { return count_.get(); }
+	inline unsigned long max() const { return max_.get(); }
+
+	/* Upper bound of the bucket containing the percentile */
+	unsigned long percentile(unsigned int percent) const {
+		unsigned long count = count_.get();
+		unsigned long target = (static_cast<uint64_t>(count) * percent + 99) / 100;
+		unsigned long total = 0;
+
+		if (!count) {
+			return 0;
+		}
+
+		for (size_t i = 0; i < BUCKETS - 1; i++) {
+			total += buckets_[i].get();
+
+			if (total >= target) {
+				return std::min((1UL << i) - 1, max());
+			}
+		}
+
+		return max();
+	}
+
+	void clear() {
+		for (auto &bucket : buckets_) {
+			bucket.clear();
+		}
+
+		count_.clear();
+		max_.clear();
+	}
+
+private:
+	std::array<Counter, BUCKETS> buckets_;
+	Counter count_;
+	Counter max_;
+};
+
+} // namespace ggroohauga
@@ -0,0 +1,115 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <uuid/log.h>
+
+#include "device.h"
+#include "stats.h"
+#include "timer.h"
+#include "z906.h"
+
+namespace ggroohauga {
+
+/*
+ * Model of the amplifier's state, kept up to date by watching the commands
+ * sent by the console and the status frames sent by the amplifier.
+ *
+ * When enabled, the console is answered locally from the model: commands
+ * are acknowledged immediately (the amplifier acknowledges a command by
+ * echoing it) and status queries get a status frame built from the model.
+ * Commands are still forwarded to the amplifier but its replies are only
+ * passed through to the console for messages that the model can't answer.
+ * The amplifier's status is polled in the background through its command
+ * queue (so that the replies aren't forwarded) to keep the model in sync.
+ */
+class AmplifierModel: public z906::Listener {
+public:
+	struct Statistics {
+		Counter commands;
+		Counter replies;
+		Counter pass_through;
+		Counter polls;
+		Counter updates;
+	};
+
+	struct State {
+		bool synced;
+		bool power;
+		bool mute;
+		z906::Status status;
+	};
+
+	static constexpr uint8_t MAX_LEVEL = z906::Status::MAX_LEVEL;
+
+	AmplifierModel(Bridge &bridge, Device &console, Device &amplifier);
+
+	AmplifierModel(const AmplifierModel&) = delete;
+	AmplifierModel& operator=(const AmplifierModel&) = delete;
+
+	/* Main loop */
+	void enable(bool enable);
+	inline bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+	State state() const;
+	/* Number of times the state may have changed (never cleared) */
+	inline unsigned long changes() const { return changes_.get(); }
+	inline const Statistics &stats() const { return stats_; }
+	void clear_stats();
+
+	/* Forwarding context */
+	void start();
+
+	void input(const z906::Message &message, z906::Input input) override;
+	void level(const z906::Message &message, z906::Channel channel, bool up) override;
+	void power(const z906::Message &message, bool on) override;
+	void effect(const z906::Message &message, z906::Effect effect) override;
+	void mute(const z906::Message &message, bool on) override;
+	void query(const z906::Message &message, z906::Query query) override;
+	void control(const z906::Message &message, z906::Control control) override;
+	void status(const z906::Message &message, const z906::Status &status) override;
+	void unknown(const z906::Message &message) override;
+
+private:
+	static constexpr unsigned long POLL_INTERVAL_MS = 1000;
+
+	bool answering(const z906::Message &message) const;
+	void acknowledge(const z906::Message &message);
+	void reply_status();
+	void pass_through(const z906::Message &message);
+	void poll();
+
+	uuid::log::Logger logger_;
+	Bridge &bridge_;
+	Device &con_;
+	Device &amp_;
+	std::atomic<bool> enabled_{false};
+	State state_{};
+	std::array<uint8_t, z906::STATUS_LEN> status_data_{};
+	MemberTimer<AmplifierModel, &AmplifierModel::poll> poll_timer_{this};
+	Counter changes_;
+	Statistics stats_;
+};
+
+} // namespace ggroohauga
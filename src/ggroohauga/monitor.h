@@ -0,0 +1,99 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "device.h"
+#include "frame.h"
+#include "stats.h"
+
+namespace ggroohauga {
+
+/*
+ * Stream of completed frames for one shell session. Frames are filtered
+ * and copied into the monitor's own buffer in the forwarding context, then
+ * formatted by the session from the main loop. If the session doesn't keep
+ * up then frames are dropped (and counted) instead of delaying forwarding.
+ */
+class FrameMonitor: public FrameObserver {
+public:
+	struct Statistics {
+		Counter frames;
+		Counter dropped;
+	};
+
+	static constexpr int ANY_OPCODE = -1;
+	static constexpr size_t BUFFER_SIZE = 2048;
+
+	/* The opcode is a command or frame type */
+	FrameMonitor(Bridge &bridge, bool console, bool amplifier, int opcode);
+	~FrameMonitor() override;
+
+	FrameMonitor(const FrameMonitor&) = delete;
+	FrameMonitor& operator=(const FrameMonitor&) = delete;
+
+	/* Main loop (returns false if there are too many monitors) */
+	bool start();
+	void stop();
+
+	/* Returns false if there are no more frames */
+	bool pop(Frame &frame);
+
+	/* Returns the number of frames dropped since the last call */
+	unsigned long new_drops();
+
+	inline const Statistics &stats() const { return stats_; }
+
+	/* Forwarding context */
+	void frame_reported(const Frame &frame) override;
+
+private:
+	struct Header {
+		uint32_t timestamp_ms;
+		uint16_t len;
+		Direction direction;
+		bool discarded;
+	};
+
+	static_assert((BUFFER_SIZE & (BUFFER_SIZE - 1)) == 0, "Size must be a power of 2");
+	static_assert(BUFFER_SIZE >= sizeof(Header) + Frame::MAX_LEN, "Buffer must fit a frame");
+
+	bool match(const Frame &frame) const;
+	void write(size_t pos, const void *data, size_t len);
+	void read(size_t pos, void *data, size_t len) const;
+
+	Bridge &bridge_;
+	const bool console_;
+	const bool amplifier_;
+	const int opcode_;
+	bool active_ = false;
+	std::array<uint8_t, BUFFER_SIZE> buffer_;
+	std::atomic<size_t> head_{0};
+	std::atomic<size_t> tail_{0};
+	unsigned long dropped_ = 0; /* Reported by new_drops() */
+	Statistics stats_;
+};
+
+} // namespace ggroohauga
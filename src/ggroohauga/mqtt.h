@@ -0,0 +1,134 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#ifdef ARDUINO_ARCH_ESP32
+# include <mqtt_client.h>
+#endif
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "sim.h"
+#include "stats.h"
+
+/*
+ * Broker to publish the amplifier's state to (e.g. "mqtt://192.0.2.1").
+ * Publishing is disabled if this is empty.
+ */
+#ifndef GGROOHAUGA_MQTT_URI
+# define GGROOHAUGA_MQTT_URI ""
+#endif
+
+/* Prefix for the topics that state is published to */
+#ifndef GGROOHAUGA_MQTT_TOPIC
+# define GGROOHAUGA_MQTT_TOPIC "ggroohauga"
+#endif
+
+namespace ggroohauga {
+
+/*
+ * MQTT client that only publishes (QoS 0). Publishing never waits for the
+ * network: messages are dropped if the client isn't connected or its
+ * buffer is full.
+ *
+ * On the ESP32 this uses the ESP-IDF MQTT client, which sends queued
+ * messages from its own task. In simulation it's a minimal client using
+ * non-blocking sockets (so that it can be tested with a local broker).
+ */
+class MqttClient {
+public:
+	struct Statistics {
+		Counter connects;
+		Counter published;
+		Counter dropped;
+	};
+
+	static constexpr uint16_t KEEPALIVE_S = 60;
+
+	MqttClient() = default;
+	~MqttClient();
+
+	MqttClient(const MqttClient&) = delete;
+	MqttClient& operator=(const MqttClient&) = delete;
+
+	/* Main loop (returns false if the URI is invalid) */
+	bool begin(const char *uri);
+	void loop();
+	inline bool connected() const { return connected_.load(std::memory_order_relaxed); }
+
+	/* Returns false if the message was dropped */
+	bool publish(const char *topic, const char *payload, bool retain);
+
+	inline const Statistics &stats() const { return stats_; }
+	void clear_stats();
+
+private:
+#ifdef ARDUINO_ARCH_ESP32
+	static void event_handler(void *arg, esp_event_base_t base,
+		int32_t event_id, void *event_data);
+
+	esp_mqtt_client_handle_t client_ = nullptr;
+#else
+	static constexpr uint16_t DEFAULT_PORT = 1883;
+	static constexpr unsigned long RETRY_INTERVAL_MS = 5000;
+	static constexpr size_t TX_BUFFER_SIZE = 1024;
+	static constexpr size_t RX_BUFFER_SIZE = 16;
+
+	enum class State : uint8_t {
+		Disabled,
+		Disconnected,
+		Connecting,
+		Handshake,
+		Connected,
+	};
+
+	void connect();
+	void handshake();
+	void disconnect();
+
+	/* Returns false if the packet doesn't fit in the buffer */
+	bool start_packet(uint8_t type, size_t remaining);
+	void append(const void *data, size_t len);
+	void append_u16(uint16_t value);
+	void append_string(const char *text, size_t len);
+
+	/* These return false if the connection has failed */
+	bool flush();
+	bool receive();
+
+	State state_ = State::Disabled;
+	int fd_ = -1;
+	uint32_t address_ = 0; /* Network byte order */
+	uint16_t port_ = DEFAULT_PORT;
+	unsigned long retry_ms_ = 0;
+	unsigned long tx_ms_ = 0;
+	std::array<uint8_t, TX_BUFFER_SIZE> tx_buffer_;
+	size_t tx_len_ = 0;
+	std::array<uint8_t, RX_BUFFER_SIZE> rx_buffer_;
+	size_t rx_len_ = 0;
+#endif
+	std::atomic<bool> connected_{false};
+	Statistics stats_;
+};
+
+} // namespace ggroohauga
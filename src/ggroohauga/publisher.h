@@ -0,0 +1,114 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstdint>
+
+#include <uuid/log.h>
+
+#include "device.h"
+#include "model.h"
+#include "mqtt.h"
+#include "stats.h"
+#include "z906.h"
+
+namespace ggroohauga {
+
+/*
+ * Publishes the amplifier's state (from the model) and the state of the
+ * proxied pins to MQTT as retained messages, one topic per value.
+ *
+ * The model and the proxies count their changes in the forwarding context,
+ * so the main loop only samples the state when something has changed.
+ * Changes are published no more often than the publish interval, and only
+ * the values that have changed since they were last published are sent,
+ * so bursts of changes (e.g. turning the volume knob) are coalesced. A
+ * pin that changed and changed back again in the meantime is published as
+ * a pulse (both values) instead of being missed.
+ */
+class StatePublisher {
+public:
+	struct Statistics {
+		Counter samples;
+		Counter changes;
+	};
+
+	static constexpr bool ENABLED = sizeof(GGROOHAUGA_MQTT_URI) > 1;
+	static constexpr unsigned long INTERVAL_MS = 250; /* Minimum time between updates */
+
+	StatePublisher(Bridge &bridge, const AmplifierModel &model,
+		const Proxy &power, const Proxy &console, const Proxy &amplifier);
+
+	StatePublisher(const StatePublisher&) = delete;
+	StatePublisher& operator=(const StatePublisher&) = delete;
+
+	/* Main loop */
+	void start(const char *uri = GGROOHAUGA_MQTT_URI);
+	void loop();
+
+	inline const MqttClient &client() const { return client_; }
+	inline const Statistics &stats() const { return stats_; }
+	void clear_stats();
+
+private:
+	struct Pin {
+		bool on;
+		unsigned long changes;
+	};
+
+	struct State {
+		unsigned long changes;
+		Pin console;
+		Pin amplifier;
+		Pin power;
+		bool synced;
+		bool mute;
+		z906::Input input;
+		z906::Effect effect;
+		std::array<uint8_t, z906::Status::NUM_CHANNELS> levels;
+	};
+
+	bool changed() const;
+	State sample() const;
+	/* These return false if any messages were dropped */
+	bool publish(const State &state, bool all);
+	bool publish(const char *topic, const Pin &pin, const Pin &previous,
+		bool all, unsigned long &changes);
+	bool publish(const char *topic, const char *value);
+	bool publish(const char *topic, bool value);
+
+	uuid::log::Logger logger_;
+
+	Bridge &bridge_;
+	const AmplifierModel &model_;
+	const Proxy &power_;
+	const Proxy &console_;
+	const Proxy &amplifier_;
+	MqttClient client_;
+	bool started_ = false;
+	bool published_ = false; /* Since the client connected */
+	State state_{};
+	unsigned long publish_ms_ = 0;
+	Statistics stats_;
+};
+
+} // namespace ggroohauga
@@ -0,0 +1,80 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace ggroohauga {
+
+/*
+ * Lock-free bounded queue for exactly one producer context and one consumer
+ * context.
+ */
+template<typename T, size_t N>
+class SpscQueue {
+public:
+	static_assert(N > 0 && (N & (N - 1)) == 0, "Size must be a power of 2");
+
+	SpscQueue() = default;
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	static constexpr size_t capacity() { return N; }
+
+	/* The value is only moved from if there is space in the queue */
+	bool push(T &&value) {
+		size_t head = head_.load(std::memory_order_relaxed);
+
+		if (head - tail_.load(std::memory_order_acquire) == N) {
+			return false;
+		}
+
+		items_[head % N] = std::move(value);
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &value) {
+		size_t tail = tail_.load(std::memory_order_relaxed);
+
+		if (head_.load(std::memory_order_acquire) == tail) {
+			return false;
+		}
+
+		value = std::move(items_[tail % N]);
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() const {
+		return head_.load(std::memory_order_relaxed)
+			- tail_.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::array<T, N> items_;
+	std::atomic<size_t> head_{0};
+	std::atomic<size_t> tail_{0};
+};
+
+} // namespace ggroohauga
@@ -0,0 +1,116 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <uuid/log.h>
+
+#include "capture.h"
+#include "device.h"
+#include "frame.h"
+#include "queue.h"
+#include "stats.h"
+
+namespace ggroohauga {
+
+/*
+ * Replay a capture through the bridge as if the traffic had been received
+ * from the console and amplifier.
+ *
+ * The bytes of each frame are injected into the device that originally
+ * received them (so they're transmitted to the other side) at the speed
+ * of the bus, and the device finds the end of the frame itself. Pin changes
+ * override the input of the matching monitor. Records are replayed with
+ * their original timing or with long idle periods shortened so that
+ * debounce and report timeouts still behave the same way.
+ *
+ * Every reported frame is compared with the recorded frame to check that
+ * the bridge reproduces the same frame boundaries. Latency is measured from
+ * the time that each byte was due. Traffic received from the real bus
+ * during a replay will be counted as extra.
+ */
+class Replay: public FrameObserver {
+public:
+	struct Statistics {
+		Counter records;
+		Counter frames;
+		Counter pins;
+		Counter matched;
+		Counter mismatched;
+		Counter missing;
+		Counter extra;
+	};
+
+	Replay(Bridge &bridge, Device &console, Device &amplifier);
+
+	/* Main loop */
+	bool start(bool fast);
+	void stop();
+	void loop();
+	inline bool active() const { return active_; }
+	inline bool fast() const { return fast_; }
+	inline const Statistics &stats() const { return stats_; }
+
+	/* Forwarding context */
+	void frame_reported(const Frame &frame) override;
+
+private:
+	static constexpr size_t EXPECTED_SIZE = 16;
+	static constexpr size_t MAX_RECORDS_PER_LOOP = 8;
+	static constexpr uint32_t FAST_MAX_GAP_US = 50000; /* > MAX_REPORT_DELAY_MS */
+	static constexpr unsigned long FINISH_DELAY_MS = 100;
+
+	struct Expected {
+		size_t length;
+		uint32_t hash;
+	};
+
+	static uint32_t hash(const uint8_t *data, size_t len);
+
+	bool next();
+	uint32_t due_us() const;
+	bool due() const;
+	void inject();
+	void finish();
+
+	uuid::log::Logger logger_;
+	Bridge &bridge_;
+	Device &con_;
+	Device &amp_;
+	bool active_ = false;
+	bool fast_ = false;
+	bool pending_ = false;
+	bool finishing_ = false;
+	size_t offset_ = 0;
+	size_t position_ = 0; /* Bytes of the current frame record injected */
+	uint32_t last_time_us_ = 0;
+	uint32_t due_us_ = 0;
+	unsigned long start_us_ = 0;
+	unsigned long finish_ms_ = 0;
+	Capture::Record record_;
+	std::array<SpscQueue<Expected, EXPECTED_SIZE>, 2> expected_;
+	Statistics stats_;
+};
+
+} // namespace ggroohauga
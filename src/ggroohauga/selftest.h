@@ -0,0 +1,54 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+/*
+ * Run tests of the bridge instead of the application. This is only
+ * available in simulation because the tests use their own serial ports and
+ * pins.
+ *
+ * Some tests only apply to other build configurations (e.g. receive events)
+ * and are skipped when they're not enabled. Builds with receive events or
+ * the bridge task should also be tested with ThreadSanitizer.
+ *
+ * Results are written to stdout in TAP format.
+ */
+#ifndef GGROOHAUGA_SELFTEST
+# define GGROOHAUGA_SELFTEST 0
+#endif
+
+#if GGROOHAUGA_SELFTEST && !defined(GGROOHAUGA_SIMULATION)
+# error "Self-tests require simulation"
+#endif
+
+namespace ggroohauga {
+
+class App;
+
+namespace selftest {
+
+static constexpr bool ENABLED = GGROOHAUGA_SELFTEST;
+
+/* Returns the process exit status (the application must not be started) */
+int run(App &app);
+
+} // namespace selftest
+
+} // namespace ggroohauga
@@ -0,0 +1,187 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * In-memory stand-ins for the ESP32 hardware used by the bridge, so that it
+ * can be built and run natively:
+ *
+ * - Serial ports are connected in pairs and paced at the configured baud
+ *   rate (this can be disabled). Received data that doesn't fit in the
+ *   fixed size receive buffer is lost.
+ * - GPIO pins can be driven externally and have their outputs inspected.
+ *   Driving a pin to a different level calls its interrupt handler.
+ * - The clock follows real time unless it's switched to manual mode.
+ */
+#ifdef GGROOHAUGA_SIMULATION
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#ifndef LOW
+# define LOW 0x0
+#endif
+#ifndef HIGH
+# define HIGH 0x1
+#endif
+#ifndef INPUT
+# define INPUT 0x01
+#endif
+#ifndef OUTPUT
+# define OUTPUT 0x03
+#endif
+#ifndef INPUT_PULLUP
+# define INPUT_PULLUP 0x05
+#endif
+#ifndef INPUT_PULLDOWN
+# define INPUT_PULLDOWN 0x09
+#endif
+#ifndef CHANGE
+# define CHANGE 0x03
+#endif
+#ifndef ARDUINO_ISR_ATTR
+# define ARDUINO_ISR_ATTR
+#endif
+#ifndef SERIAL_8N1
+# define SERIAL_8N1 0x800001c
+#endif
+#ifndef SERIAL_8O1
+# define SERIAL_8O1 0x800001f
+#endif
+
+#define NEO_GRB 0x52
+#define NEO_KHZ800 0x0000
+
+class HardwareSerial {
+public:
+	using OnReceiveCb = std::function<void(void)>;
+
+	HardwareSerial();
+	~HardwareSerial();
+
+	HardwareSerial(const HardwareSerial&) = delete;
+	HardwareSerial& operator=(const HardwareSerial&) = delete;
+
+	void begin(unsigned long baud, uint32_t config = SERIAL_8N1,
+		int8_t rx_pin = -1, int8_t tx_pin = -1);
+	void end();
+
+	int available();
+	int peek();
+	int read();
+	size_t read(uint8_t *buffer, size_t size);
+	size_t write(uint8_t value);
+	size_t write(const uint8_t *buffer, size_t size);
+	void flush();
+
+	void onReceive(OnReceiveCb function, bool only_on_timeout = false);
+	bool setRxTimeout(uint8_t symbols);
+	bool setRxFIFOFull(uint8_t bytes);
+
+	/* Simulation */
+	void connect(HardwareSerial &peer);
+	void pacing(bool enabled);
+	unsigned long char_time_us() const;
+	/* Number of bytes that haven't finished being transmitted */
+	size_t tx_queued() const;
+	/* Check and clear the receive overflow flag */
+	bool rx_overflow();
+	void poll();
+
+private:
+	static constexpr size_t RX_BUFFER_SIZE = 1024;
+
+	struct Byte {
+		uint64_t time_us;
+		uint8_t value;
+	};
+
+	void receive(uint64_t time_us, uint8_t value);
+	size_t available_locked(uint64_t now_us) const;
+
+	mutable std::mutex mutex_;
+	HardwareSerial *peer_ = nullptr;
+	bool active_ = false;
+	bool pacing_ = true;
+	unsigned long baud_ = 0;
+	unsigned long bits_ = 10;
+	uint64_t tx_idle_us_ = 0;
+	std::array<Byte, RX_BUFFER_SIZE> rx_;
+	size_t rx_head_ = 0;
+	size_t rx_len_ = 0;
+	size_t rx_notified_ = 0;
+	bool rx_overflow_ = false;
+	OnReceiveCb on_receive_;
+};
+
+/* MCU UARTs connected to the console and amplifier */
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+class Adafruit_NeoPixel {
+public:
+	Adafruit_NeoPixel(uint16_t n __attribute__((unused)),
+		int16_t pin __attribute__((unused)),
+		uint16_t type __attribute__((unused))) {}
+
+	void begin() {}
+	void show() {}
+};
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+namespace ggroohauga {
+
+namespace sim {
+
+/* Serial ports of the original console and amplifier */
+extern HardwareSerial console;
+extern HardwareSerial amplifier;
+
+uint64_t now_us();
+void manual_clock(bool manual);
+void advance_us(uint64_t us);
+
+/* Call receive callbacks for all serial ports that have new data */
+void poll();
+
+/* Drive an input pin externally, or release it (value -1) */
+void drive(uint8_t pin, int value);
+
+/* Returns the value of an output pin, or -1 if it's not an output */
+int output(uint8_t pin);
+
+} // namespace sim
+
+} // namespace ggroohauga
+
+#endif
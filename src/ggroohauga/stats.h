@@ -0,0 +1,87 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+
+namespace ggroohauga {
+
+/*
+ * Statistics counter with a single writer. Reads and clears can happen from
+ * any context without locking, so updates use relaxed loads/stores instead
+ * of a read-modify-write.
+ */
+class Counter {
+public:
+	Counter() = default;
+
+	Counter(const Counter&) = delete;
+	Counter& operator=(const Counter&) = delete;
+
+	inline void add(unsigned long value = 1) {
+		value_.store(value_.load(std::memory_order_relaxed) + value,
+			std::memory_order_relaxed);
+	}
+
+	inline void max(unsigned long value) {
+		if (value > value_.load(std::memory_order_relaxed)) {
+			value_.store(value, std::memory_order_relaxed);
+		}
+	}
+
+	inline unsigned long get() const {
+		return value_.load(std::memory_order_relaxed);
+	}
+
+	inline void clear() {
+		value_.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<unsigned long> value_{0};
+};
+
+/*
+ * Statistics counter that can be updated from more than one context at the
+ * same time.
+ */
+class SharedCounter {
+public:
+	SharedCounter() = default;
+
+	SharedCounter(const SharedCounter&) = delete;
+	SharedCounter& operator=(const SharedCounter&) = delete;
+
+	inline void add(unsigned long value = 1) {
+		value_.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	inline unsigned long get() const {
+		return value_.load(std::memory_order_relaxed);
+	}
+
+	inline void clear() {
+		value_.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<unsigned long> value_{0};
+};
+
+} // namespace ggroohauga
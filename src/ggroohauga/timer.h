@@ -0,0 +1,130 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "sim.h"
+#include "stats.h"
+
+namespace ggroohauga {
+
+class Scheduler;
+
+/*
+ * One-shot deadline that calls its callback from Scheduler::run() once the
+ * deadline has passed. Starting a timer that is already armed moves its
+ * deadline.
+ */
+class Timer {
+public:
+	Timer(const Timer&) = delete;
+	Timer& operator=(const Timer&) = delete;
+
+	inline bool armed() const { return index_ != NOT_ARMED; }
+	inline unsigned long deadline_us() const { return deadline_us_; }
+
+	void start(Scheduler &scheduler, unsigned long deadline_us);
+	void cancel();
+
+protected:
+	using Callback = void (*)(Timer &timer);
+
+	explicit Timer(Callback callback) : callback_(callback) {}
+	~Timer();
+
+private:
+	friend class Scheduler;
+
+	static constexpr size_t NOT_ARMED = SIZE_MAX;
+
+	const Callback callback_;
+	Scheduler *scheduler_ = nullptr;
+	unsigned long deadline_us_ = 0;
+	size_t index_ = NOT_ARMED;
+};
+
+/*
+ * Timer that calls a member function of its owner. The function is a
+ * template argument so that it can be inlined into the callback.
+ */
+template<typename T, void (T::*Function)()>
+class MemberTimer final: public Timer {
+public:
+	explicit MemberTimer(T *object) : Timer(&expired), object_(object) {}
+
+private:
+	static void expired(Timer &timer) {
+		(static_cast<MemberTimer&>(timer).object_->*Function)();
+	}
+
+	T *const object_;
+};
+
+/*
+ * Min-heap of armed timers ordered by deadline (in micros(), allowing for
+ * wraparound). Only expired timers are visited when it runs, and the time
+ * until the next deadline is available so that callers can sleep until
+ * then.
+ *
+ * A scheduler and its timers must only be used from one context (or with
+ * the same lock held).
+ */
+class Scheduler {
+public:
+	static constexpr size_t MAX_TIMERS = 16;
+
+	Scheduler() = default;
+
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator=(const Scheduler&) = delete;
+
+	/* Call the callbacks of all expired timers */
+	void run();
+
+	/* Returns false if there are no armed timers */
+	bool next(unsigned long &remaining_us) const;
+
+	inline size_t armed() const { return size_; }
+	inline const Counter &overflow() const { return overflow_; }
+
+private:
+	friend class Timer;
+
+	static inline bool before(const Timer *a, const Timer *b) {
+		return (long)(a->deadline_us_ - b->deadline_us_) < 0;
+	}
+
+	bool add(Timer &timer);
+	void remove(Timer &timer);
+	void update(Timer &timer);
+	void place(Timer *timer, size_t index);
+	void sift_up(size_t index);
+	void sift_down(size_t index);
+
+	std::array<Timer*, MAX_TIMERS> heap_{};
+	size_t size_ = 0;
+	Counter overflow_;
+};
+
+} // namespace ggroohauga
@@ -0,0 +1,101 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "frame.h"
+
+namespace ggroohauga {
+
+enum class TraceFormat : uint8_t {
+	Raw,     /* Hex only, 24 bytes per record */
+	Decoded, /* Decoded messages and hex, one record per frame */
+};
+
+/*
+ * Log message text that is built without any formatting functions. Text
+ * that doesn't fit is silently truncated.
+ */
+class TraceLine {
+public:
+	/* Longest message that uuid::log will output */
+	static constexpr size_t MAX_LEN = 255;
+
+	TraceLine() = default;
+
+	TraceLine(const TraceLine&) = delete;
+	TraceLine& operator=(const TraceLine&) = delete;
+
+	inline const char *c_str() const { return text_.data(); }
+	inline size_t size() const { return len_; }
+	inline size_t remaining() const { return MAX_LEN - len_; }
+
+	inline void clear() {
+		len_ = 0;
+		text_[0] = '\0';
+	}
+
+	inline void truncate(size_t len) {
+		if (len < len_) {
+			len_ = len;
+			text_[len_] = '\0';
+		}
+	}
+
+	void append(char value);
+	void append(const char *text);
+	void append(const __FlashStringHelper *text);
+	void append(unsigned long value);
+
+	/* Seconds and milliseconds */
+	void append_timestamp(unsigned long timestamp_ms);
+
+	/*
+	 * Appends as many bytes of data as will fit (keeping space for the
+	 * reserved number of characters), optionally with a space before each
+	 * byte. Returns the number of bytes appended.
+	 */
+	size_t append_hex(const uint8_t *data, size_t len, bool spaced, size_t reserve = 0);
+
+private:
+	std::array<char, MAX_LEN + 1> text_{};
+	size_t len_ = 0;
+};
+
+/*
+ * Appends the names and fields of the messages in a frame. Frames that
+ * aren't valid are described as malformed.
+ */
+void annotate(TraceLine &line, const Frame &frame);
+
+/*
+ * Replaces the line with a decoded record of the frame from the data at
+ * pos (records after the first one only have data). Returns the position
+ * to continue from, which is the end of the frame unless it's too long to
+ * fit in one record. Every record has at least one byte of data, so the
+ * annotation is cut short if it would fill the line.
+ */
+size_t format_frame(TraceLine &line, const Frame &frame, size_t pos);
+
+} // namespace ggroohauga
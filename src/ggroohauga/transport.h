@@ -0,0 +1,148 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#ifdef ARDUINO_ARCH_ESP32
+# include <hal/uart_ll.h>
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "sim.h"
+#include "stats.h"
+
+/*
+ * Read and write the UART FIFOs directly instead of going through the
+ * HardwareSerial driver's ring buffers. Received data must be read before
+ * the RX FIFO fills up so this only supports polling (not receive events).
+ *
+ * In simulation the FIFOs are modelled on top of the simulated serial
+ * ports.
+ */
+#ifndef GGROOHAUGA_UART_FIFO
+# define GGROOHAUGA_UART_FIFO 0
+#endif
+
+namespace ggroohauga {
+
+/* Serial port accessed through the HardwareSerial driver */
+class SerialTransport {
+public:
+	struct Statistics {
+		Counter rx_overflows; /* Received data lost by the driver */
+	};
+
+	SerialTransport(HardwareSerial &serial, uint8_t uart_num,
+		uint8_t rx_pin, uint8_t tx_pin);
+
+	SerialTransport(const SerialTransport&) = delete;
+	SerialTransport& operator=(const SerialTransport&) = delete;
+
+	void begin(unsigned long baud, uint32_t config);
+	void end();
+	void on_receive(std::function<void()> function,
+		uint8_t timeout_symbols, uint8_t fifo_full);
+
+	size_t available();
+	size_t read(uint8_t *data, size_t len);
+	size_t write(const uint8_t *data, size_t len);
+	inline void poll() {}
+
+	inline const Statistics &stats() const { return stats_; }
+	void clear_stats();
+
+private:
+	HardwareSerial &serial_;
+	const uint8_t rx_pin_;
+	const uint8_t tx_pin_;
+	Statistics stats_;
+};
+
+/*
+ * Serial port accessed through the UART FIFOs. Data that doesn't fit in the
+ * TX FIFO is buffered until the next call to poll().
+ *
+ * The RX FIFO overflow flag is checked (and cleared) every time the FIFO is
+ * read, so that lost data is counted.
+ */
+class FifoTransport {
+public:
+	struct Statistics {
+		Counter rx_overflows; /* The RX FIFO was full when data was received */
+	};
+
+	static constexpr size_t FIFO_SIZE = 128;
+	static constexpr size_t TX_BUFFER_SIZE = 256;
+
+	FifoTransport(HardwareSerial &serial, uint8_t uart_num,
+		uint8_t rx_pin, uint8_t tx_pin);
+
+	FifoTransport(const FifoTransport&) = delete;
+	FifoTransport& operator=(const FifoTransport&) = delete;
+
+	void begin(unsigned long baud, uint32_t config);
+	void end();
+
+	/* Receive events aren't supported */
+	inline void on_receive(std::function<void()> function __attribute__((unused)),
+		uint8_t timeout_symbols __attribute__((unused)),
+		uint8_t fifo_full __attribute__((unused))) {}
+
+	size_t available();
+	size_t read(uint8_t *data, size_t len);
+	size_t write(const uint8_t *data, size_t len);
+
+	/* Move buffered data into the TX FIFO */
+	void poll();
+
+	inline const Statistics &stats() const { return stats_; }
+	void clear_stats();
+
+private:
+	void check_overflow();
+	size_t tx_free();
+	void tx_fifo(const uint8_t *data, size_t len);
+
+#ifdef ARDUINO_ARCH_ESP32
+	const uint8_t uart_num_;
+	uart_dev_t *const hw_;
+	bool module_disabled_ = false;
+#else
+	HardwareSerial &serial_;
+#endif
+	const uint8_t rx_pin_;
+	const uint8_t tx_pin_;
+	bool active_ = false;
+	std::array<uint8_t, TX_BUFFER_SIZE> tx_buffer_;
+	size_t tx_head_ = 0;
+	size_t tx_len_ = 0;
+	Statistics stats_;
+};
+
+#if GGROOHAUGA_UART_FIFO
+using Transport = FifoTransport;
+#else
+using Transport = SerialTransport;
+#endif
+
+} // namespace ggroohauga
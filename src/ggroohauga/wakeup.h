@@ -0,0 +1,88 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#ifdef ARDUINO_ARCH_ESP32
+# include <freertos/FreeRTOS.h>
+# include <freertos/semphr.h>
+#else
+# include <condition_variable>
+# include <mutex>
+#endif
+
+#include <atomic>
+
+#include "histogram.h"
+#include "sim.h"
+#include "stats.h"
+
+namespace ggroohauga {
+
+/*
+ * Event that one context can block on until another context or an
+ * interrupt handler has something for it to do. Notifications while
+ * nobody is waiting aren't lost: the next wait returns immediately.
+ */
+class Wakeup {
+public:
+	struct Statistics {
+		Counter waits;
+		Counter wakeups; /* Waits that ended with a notification */
+		Counter idle_ms; /* Time spent waiting */
+
+		/* Time from the first notification to the end of the wait (µs) */
+		Histogram latency_us;
+	};
+
+	Wakeup();
+	~Wakeup();
+
+	Wakeup(const Wakeup&) = delete;
+	Wakeup& operator=(const Wakeup&) = delete;
+
+	void notify();
+	void notify_from_isr();
+
+	/* Returns true if there was a notification before the timeout */
+	bool wait(unsigned long timeout_us);
+
+	inline const Statistics &stats() const { return stats_; }
+	unsigned long idle_permille() const;
+	void clear_stats();
+
+private:
+	void notified();
+
+#ifdef ARDUINO_ARCH_ESP32
+	StaticSemaphore_t buffer_;
+	SemaphoreHandle_t semaphore_;
+#else
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	bool notified_ = false;
+#endif
+	std::atomic<bool> pending_{false};
+	std::atomic<unsigned long> notify_us_{0};
+	unsigned long idle_us_ = 0; /* Less than 1ms, not yet in idle_ms */
+	std::atomic<unsigned long> cleared_ms_{::millis()};
+	Statistics stats_;
+};
+
+} // namespace ggroohauga
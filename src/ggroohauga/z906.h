@@ -0,0 +1,251 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "frame.h"
+
+namespace ggroohauga {
+
+namespace z906 {
+
+/*
+ * Messages are either a single command byte or a frame:
+ *
+ *   0xAA, type, length, data[length], checksum
+ *
+ * The checksum is the sum of the type, length and data bytes.
+ */
+static constexpr uint8_t FRAME_START = 0xAA;
+static constexpr size_t FRAME_HEADER_LEN = 3;
+static constexpr size_t FRAME_OVERHEAD = FRAME_HEADER_LEN + 1;
+
+static constexpr uint8_t STATUS_TYPE = 0x0A;
+static constexpr uint8_t STATUS_LEN = 20;
+
+constexpr uint8_t checksum(const uint8_t *frame, size_t len) {
+	uint8_t sum = 0;
+
+	for (size_t i = 1; i < len - 1; i++) {
+		sum += frame[i];
+	}
+
+	return sum;
+}
+
+/* Checks that the data is exactly one complete frame */
+constexpr bool valid_frame(const uint8_t *frame, size_t len) {
+	return len >= FRAME_OVERHEAD
+		&& frame[0] == FRAME_START
+		&& len == FRAME_OVERHEAD + frame[2]
+		&& frame[len - 1] == checksum(frame, len);
+}
+
+enum class Input : uint8_t {
+	Input1 = 0,
+	Input2,
+	Input3,
+	Input4,
+	Input5,
+	Aux,
+};
+
+enum class Channel : uint8_t {
+	Main = 0,
+	Rear,
+	Center,
+	Sub,
+};
+
+enum class Effect : uint8_t {
+	None = 0,
+	Effect3D,
+	Effect4_1,
+	Effect2_1,
+};
+
+enum class Query : uint8_t {
+	Status = 0,
+	Temperature,
+	PowerUpTime,
+	Version,
+};
+
+enum class Control : uint8_t {
+	Save = 0,
+	BlockInputs,
+	UnblockInputs,
+	ResetPowerUpTime,
+};
+
+struct Message {
+	Direction direction;
+	uint8_t opcode;
+	bool frame;
+	const uint8_t *data; /* Frame data (excluding header and checksum) */
+	uint8_t length;
+};
+
+struct Status {
+	static constexpr size_t NUM_CHANNELS = 4;
+	static constexpr size_t NUM_INPUTS = 6;
+	static constexpr uint8_t MAX_LEVEL = 43;
+
+	std::array<uint8_t, NUM_CHANNELS> levels;
+	Input input;
+	std::array<Effect, NUM_INPUTS> effects;
+	uint8_t spdif_status;
+	uint8_t signal_status;
+	std::array<uint8_t, 3> version;
+	bool standby;
+	bool auto_standby;
+};
+
+#define UNUSED __attribute__((unused))
+
+class Listener {
+public:
+	virtual ~Listener() = default;
+
+	virtual void input(const Message &message UNUSED, Input input UNUSED) {}
+	virtual void level(const Message &message UNUSED, Channel channel UNUSED, bool up UNUSED) {}
+	virtual void power(const Message &message UNUSED, bool on UNUSED) {}
+	virtual void effect(const Message &message UNUSED, Effect effect UNUSED) {}
+	virtual void mute(const Message &message UNUSED, bool on UNUSED) {}
+	virtual void query(const Message &message UNUSED, Query query UNUSED) {}
+	virtual void control(const Message &message UNUSED, Control control UNUSED) {}
+	virtual void status(const Message &message UNUSED, const Status &status UNUSED) {}
+	virtual void unknown(const Message &message UNUSED) {}
+};
+
+#undef UNUSED
+
+struct Opcode {
+	uint8_t value;
+	bool frame;
+	const char *name; /* No spaces, so that it can be used as a shell argument */
+	void (*handler)(Listener &listener, const Message &message, uint8_t arg);
+	uint8_t arg;
+};
+
+/* Returns nullptr if the opcode is unknown */
+const Opcode *lookup(const Message &message);
+
+/* Calls the typed handler for the message on the listener */
+void dispatch(Listener &listener, const Message &message);
+
+/* Returns true if the message is a query that doesn't change any state */
+bool idempotent(const Message &message);
+
+/* Returns nullptr if there's no command with that name */
+const Opcode *find_command(const char *name);
+
+/* Calls the function for every known command */
+void for_each_command(const std::function<void(const Opcode &opcode)> &func);
+
+/* Command opcodes */
+uint8_t input_opcode(Input input);
+uint8_t level_opcode(Channel channel, bool up);
+uint8_t power_opcode(bool on);
+uint8_t effect_opcode(Effect effect);
+uint8_t mute_opcode(bool on);
+uint8_t query_opcode(Query query);
+uint8_t control_opcode(Control control);
+
+/*
+ * Writes the known fields of the status to the data (STATUS_LEN bytes) of a
+ * status frame, leaving the other bytes unchanged.
+ */
+void encode_status(const Status &status, uint8_t *data);
+
+/*
+ * Streaming parser that is fed one byte at a time. Frame data isn't stored
+ * because the device already has it in a frame buffer.
+ *
+ * A frame start in the middle of a frame is treated as data, but it's
+ * also parsed as a possible start of another frame. If the outer frame
+ * turns out to be malformed (because the checksum doesn't match) and the
+ * inner frame is still incomplete, parsing continues from the inner frame
+ * so that a stray frame start doesn't hide the frame after it.
+ */
+class Decoder {
+public:
+	enum class Result : uint8_t {
+		Incomplete,
+		Command,
+		Frame,
+		Malformed,
+
+		/*
+		 * The frame is malformed but it contained the start of another
+		 * incomplete frame, at restart() bytes from the start of the
+		 * malformed frame.
+		 */
+		Resync,
+	};
+
+	inline bool idle() const { return frame_.state == State::Idle; }
+	inline size_t restart() const { return restart_; }
+
+	Result feed(uint8_t value);
+	inline void reset() {
+		frame_.state = State::Idle;
+		inner_.state = State::Idle;
+	}
+
+private:
+	enum class State : uint8_t {
+		Idle,
+		Type,
+		Length,
+		Data,
+		Checksum,
+	};
+
+	enum class Step : uint8_t {
+		Incomplete,
+		Valid,
+		Invalid,
+	};
+
+	struct Parser {
+		/* After the frame start */
+		inline void start() { state = State::Type; }
+		Step feed(uint8_t value);
+
+		State state = State::Idle;
+		uint8_t remaining = 0;
+		uint8_t checksum = 0;
+	};
+
+	Parser frame_;
+	Parser inner_;
+	size_t length_ = 0; /* Bytes received for the current frame */
+	size_t restart_ = 0; /* Position of the inner frame start */
+};
+
+} // namespace z906
+
+} // namespace ggroohauga
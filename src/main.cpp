@@ -1,6 +1,6 @@
 /*
  * ggroohauga - Alternative console and simulated amplifier interface
- * Copyright 2022  Simon Arlott
+ * Copyright 2022,2026  Simon Arlott
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -18,8 +18,12 @@
 
 #include <Arduino.h>
 
-#include "esp32-hal.h"
+#ifndef GGROOHAUGA_SIMULATION
+# include "esp32-hal.h"
+#endif
 #include "ggroohauga/app.h"
+#include "ggroohauga/benchmark.h"
+#include "ggroohauga/selftest.h"
 
 static ggroohauga::App application;
 
@@ -31,3 +35,21 @@ void loop() {
 	application.loop();
 	::yield();
 }
+
+#ifdef GGROOHAUGA_SIMULATION
+int main() {
+	if (ggroohauga::benchmark::ENABLED) {
+		return ggroohauga::benchmark::run(application);
+	}
+
+	if (ggroohauga::selftest::ENABLED) {
+		return ggroohauga::selftest::run(application);
+	}
+
+	setup();
+
+	while (true) {
+		loop();
+	}
+}
+#endif
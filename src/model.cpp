@@ -0,0 +1,195 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/model.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+
+#include <uuid/log.h>
+
+namespace ggroohauga {
+
+AmplifierModel::AmplifierModel(Bridge &bridge, Device &console, Device &amplifier)
+		: logger_(F("model"), uuid::log::Facility::UUCP),
+		bridge_(bridge), con_(console), amp_(amplifier) {
+}
+
+void AmplifierModel::start() {
+	con_.listener(this);
+	amp_.listener(this);
+}
+
+void AmplifierModel::enable(bool enable) {
+	std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+	if (enable != enabled()) {
+		enabled_.store(enable, std::memory_order_relaxed);
+		amp_.forwarding(!enable);
+
+		if (enable) {
+			poll();
+		} else {
+			poll_timer_.cancel();
+		}
+
+		logger_.info(F("%S simulated amplifier"), enable ? F("Enabled") : F("Disabled"));
+	}
+}
+
+AmplifierModel::State AmplifierModel::state() const {
+	std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+	return state_;
+}
+
+void AmplifierModel::clear_stats() {
+	for (auto *counter : {&stats_.commands, &stats_.replies,
+			&stats_.pass_through, &stats_.polls, &stats_.updates}) {
+		counter->clear();
+	}
+}
+
+void AmplifierModel::poll() {
+	/* The status is updated from the reply when it's decoded */
+	if (amp_.submit_locked(z906::query_opcode(z906::Query::Status), nullptr)) {
+		stats_.polls.add();
+	}
+
+	poll_timer_.start(bridge_.scheduler, ::micros() + POLL_INTERVAL_MS * 1000);
+}
+
+bool AmplifierModel::answering(const z906::Message &message) const {
+	return message.direction == Direction::ConsoleToAmplifier && enabled();
+}
+
+void AmplifierModel::acknowledge(const z906::Message &message) {
+	stats_.commands.add();
+	changes_.add();
+
+	if (answering(message)) {
+		con_.transmit(&message.opcode, 1);
+		stats_.replies.add();
+	}
+}
+
+void AmplifierModel::reply_status() {
+	std::array<uint8_t, z906::FRAME_OVERHEAD + z906::STATUS_LEN> frame{
+		z906::FRAME_START, z906::STATUS_TYPE, z906::STATUS_LEN};
+
+	z906::encode_status(state_.status, status_data_.data());
+	std::copy(status_data_.begin(), status_data_.end(),
+		frame.begin() + z906::FRAME_HEADER_LEN);
+	frame.back() = z906::checksum(frame.data(), frame.size());
+
+	con_.transmit(frame.data(), frame.size());
+	stats_.replies.add();
+}
+
+void AmplifierModel::pass_through(const z906::Message &message) {
+	if (amp_.pass_through(message.opcode)) {
+		stats_.pass_through.add();
+	}
+}
+
+void AmplifierModel::input(const z906::Message &message, z906::Input input) {
+	if (message.direction == Direction::ConsoleToAmplifier) {
+		state_.status.input = input;
+		acknowledge(message);
+	}
+}
+
+void AmplifierModel::level(const z906::Message &message, z906::Channel channel, bool up) {
+	if (message.direction == Direction::ConsoleToAmplifier) {
+		uint8_t &level = state_.status.levels[static_cast<size_t>(channel)];
+
+		if (up) {
+			level = std::min<uint8_t>(level + 1, MAX_LEVEL);
+		} else if (level > 0) {
+			level--;
+		}
+
+		acknowledge(message);
+	}
+}
+
+void AmplifierModel::power(const z906::Message &message, bool on) {
+	if (message.direction == Direction::ConsoleToAmplifier) {
+		state_.power = on;
+		state_.status.standby = !on;
+		acknowledge(message);
+	}
+}
+
+void AmplifierModel::effect(const z906::Message &message, z906::Effect effect) {
+	if (message.direction == Direction::ConsoleToAmplifier) {
+		state_.status.effects[static_cast<size_t>(state_.status.input)] = effect;
+		acknowledge(message);
+	}
+}
+
+void AmplifierModel::mute(const z906::Message &message, bool on) {
+	if (message.direction == Direction::ConsoleToAmplifier) {
+		state_.mute = on;
+		acknowledge(message);
+	}
+}
+
+void AmplifierModel::query(const z906::Message &message, z906::Query query) {
+	if (!answering(message)) {
+		return;
+	}
+
+	if (query == z906::Query::Status && state_.synced) {
+		reply_status();
+	} else {
+		pass_through(message);
+	}
+}
+
+void AmplifierModel::control(const z906::Message &message,
+		z906::Control control __attribute__((unused))) {
+	if (message.direction == Direction::ConsoleToAmplifier) {
+		acknowledge(message);
+	}
+}
+
+void AmplifierModel::status(const z906::Message &message, const z906::Status &status) {
+	if (message.direction == Direction::AmplifierToConsole) {
+		std::copy(message.data, message.data + status_data_.size(),
+			status_data_.begin());
+		state_.status = status;
+		state_.power = !status.standby;
+		state_.synced = true;
+		stats_.updates.add();
+		changes_.add();
+	} else if (answering(message)) {
+		pass_through(message);
+	}
+}
+
+void AmplifierModel::unknown(const z906::Message &message) {
+	if (answering(message)) {
+		pass_through(message);
+	}
+}
+
+} // namespace ggroohauga
@@ -0,0 +1,150 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/monitor.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#include "ggroohauga/z906.h"
+
+namespace ggroohauga {
+
+FrameMonitor::FrameMonitor(Bridge &bridge, bool console, bool amplifier, int opcode)
+		: bridge_(bridge), console_(console), amplifier_(amplifier),
+			opcode_(opcode) {
+}
+
+FrameMonitor::~FrameMonitor() {
+	stop();
+}
+
+bool FrameMonitor::start() {
+	std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+	for (auto &monitor : bridge_.monitors) {
+		if (!monitor) {
+			monitor = this;
+			active_ = true;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FrameMonitor::stop() {
+	if (active_) {
+		std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+		std::replace(bridge_.monitors.begin(), bridge_.monitors.end(),
+			static_cast<FrameObserver*>(this), static_cast<FrameObserver*>(nullptr));
+		active_ = false;
+	}
+}
+
+bool FrameMonitor::match(const Frame &frame) const {
+	if (!(frame.direction() == Direction::ConsoleToAmplifier ? console_ : amplifier_)) {
+		return false;
+	}
+
+	if (opcode_ == ANY_OPCODE) {
+		return true;
+	} else if (frame.empty()) {
+		return false;
+	}
+
+	if (frame[0] == z906::FRAME_START) {
+		return frame.size() > 1 && frame[1] == opcode_;
+	}
+
+	return std::find(frame.data(), frame.data() + frame.size(), opcode_)
+		!= frame.data() + frame.size();
+}
+
+void FrameMonitor::write(size_t pos, const void *data, size_t len) {
+	size_t offset = pos % BUFFER_SIZE;
+	size_t first = std::min(len, BUFFER_SIZE - offset);
+
+	std::memcpy(&buffer_[offset], data, first);
+	std::memcpy(&buffer_[0], static_cast<const uint8_t*>(data) + first, len - first);
+}
+
+void FrameMonitor::read(size_t pos, void *data, size_t len) const {
+	size_t offset = pos % BUFFER_SIZE;
+	size_t first = std::min(len, BUFFER_SIZE - offset);
+
+	std::memcpy(data, &buffer_[offset], first);
+	std::memcpy(static_cast<uint8_t*>(data) + first, &buffer_[0], len - first);
+}
+
+void FrameMonitor::frame_reported(const Frame &frame) {
+	if (!match(frame)) {
+		return;
+	}
+
+	Header header{static_cast<uint32_t>(frame.timestamp_ms()),
+		static_cast<uint16_t>(frame.size()), frame.direction(), frame.discarded()};
+	size_t head = head_.load(std::memory_order_relaxed);
+	size_t used = head - tail_.load(std::memory_order_acquire);
+
+	if (BUFFER_SIZE - used < sizeof(header) + frame.size()) {
+		stats_.dropped.add();
+		return;
+	}
+
+	write(head, &header, sizeof(header));
+	write(head + sizeof(header), frame.data(), frame.size());
+	head_.store(head + sizeof(header) + frame.size(), std::memory_order_release);
+	stats_.frames.add();
+}
+
+bool FrameMonitor::pop(Frame &frame) {
+	size_t tail = tail_.load(std::memory_order_relaxed);
+	Header header;
+
+	if (head_.load(std::memory_order_acquire) == tail) {
+		return false;
+	}
+
+	read(tail, &header, sizeof(header));
+	frame.start(header.direction, header.timestamp_ms, 0);
+	frame.discarded(header.discarded);
+
+	for (size_t i = 0; i < header.len; i++) {
+		frame.push_back(buffer_[(tail + sizeof(header) + i) % BUFFER_SIZE]);
+	}
+
+	tail_.store(tail + sizeof(header) + header.len, std::memory_order_release);
+	return true;
+}
+
+unsigned long FrameMonitor::new_drops() {
+	unsigned long dropped = stats_.dropped.get();
+	unsigned long count = dropped - dropped_;
+
+	dropped_ = dropped;
+	return count;
+}
+
+} // namespace ggroohauga
@@ -0,0 +1,384 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/mqtt.h"
+
+#include <Arduino.h>
+#ifdef ARDUINO_ARCH_ESP32
+# include <esp_idf_version.h>
+# include <mqtt_client.h>
+#else
+# include <arpa/inet.h>
+# include <fcntl.h>
+# include <netdb.h>
+# include <netinet/in.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace ggroohauga {
+
+void MqttClient::clear_stats() {
+	for (auto *counter : {&stats_.connects, &stats_.published, &stats_.dropped}) {
+		counter->clear();
+	}
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+MqttClient::~MqttClient() {
+	if (client_) {
+		esp_mqtt_client_destroy(client_);
+	}
+}
+
+bool MqttClient::begin(const char *uri) {
+	esp_mqtt_client_config_t config{};
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+	config.broker.address.uri = uri;
+	config.session.keepalive = KEEPALIVE_S;
+#else
+	config.uri = uri;
+	config.keepalive = KEEPALIVE_S;
+#endif
+
+	client_ = esp_mqtt_client_init(&config);
+	if (!client_) {
+		return false;
+	}
+
+	esp_mqtt_client_register_event(client_, MQTT_EVENT_ANY, event_handler, this);
+	return esp_mqtt_client_start(client_) == ESP_OK;
+}
+
+void MqttClient::event_handler(void *arg, esp_event_base_t base __attribute__((unused)),
+		int32_t event_id, void *event_data __attribute__((unused))) {
+	auto *client = reinterpret_cast<MqttClient*>(arg);
+
+	switch (event_id) {
+	case MQTT_EVENT_CONNECTED:
+		client->stats_.connects.add();
+		client->connected_.store(true, std::memory_order_relaxed);
+		break;
+
+	case MQTT_EVENT_DISCONNECTED:
+		client->connected_.store(false, std::memory_order_relaxed);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void MqttClient::loop() {
+}
+
+bool MqttClient::publish(const char *topic, const char *payload, bool retain) {
+	/*
+	 * The message is added to the outbox and sent from the MQTT client's
+	 * task (unlike esp_mqtt_client_publish(), which sends it immediately).
+	 */
+	if (!connected() || esp_mqtt_client_enqueue(client_, topic, payload,
+			0, 0, retain ? 1 : 0, true) < 0) {
+		stats_.dropped.add();
+		return false;
+	}
+
+	stats_.published.add();
+	return true;
+}
+#else
+static constexpr uint8_t CONNECT = 0x10;
+static constexpr uint8_t CONNACK = 0x20;
+static constexpr uint8_t PUBLISH = 0x30;
+static constexpr uint8_t PUBLISH_RETAIN = 0x01;
+static constexpr uint8_t PINGREQ = 0xC0;
+static constexpr uint8_t PINGRESP = 0xD0;
+static constexpr uint8_t DISCONNECT = 0xE0;
+static constexpr uint8_t PROTOCOL_LEVEL = 4; /* 3.1.1 */
+static constexpr uint8_t CLEAN_SESSION = 0x02;
+static const char CLIENT_ID[] = "ggroohauga";
+
+MqttClient::~MqttClient() {
+	if (state_ == State::Connected) {
+		start_packet(DISCONNECT, 0);
+		flush();
+	}
+
+	disconnect();
+}
+
+bool MqttClient::begin(const char *uri) {
+	static const char SCHEME[] = "mqtt://";
+	std::string host;
+	size_t pos;
+	struct addrinfo hints{};
+	struct addrinfo *result = nullptr;
+
+	if (std::strncmp(uri, SCHEME, sizeof(SCHEME) - 1)) {
+		return false;
+	}
+
+	host = &uri[sizeof(SCHEME) - 1];
+	pos = host.find(':');
+
+	if (pos != std::string::npos) {
+		port_ = std::strtoul(host.c_str() + pos + 1, nullptr, 10);
+		host.resize(pos);
+	}
+
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(host.c_str(), nullptr, &hints, &result) || !result) {
+		return false;
+	}
+
+	address_ = reinterpret_cast<struct sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+	freeaddrinfo(result);
+
+	state_ = State::Disconnected;
+	retry_ms_ = millis() - RETRY_INTERVAL_MS;
+	return true;
+}
+
+void MqttClient::loop() {
+	switch (state_) {
+	case State::Disabled:
+		return;
+
+	case State::Disconnected:
+		if (millis() - retry_ms_ >= RETRY_INTERVAL_MS) {
+			connect();
+		}
+		return;
+
+	case State::Connecting: {
+			struct pollfd pfd{fd_, POLLOUT, 0};
+			int error = 0;
+			socklen_t len = sizeof(error);
+
+			if (::poll(&pfd, 1, 0) <= 0) {
+				if (millis() - retry_ms_ >= RETRY_INTERVAL_MS) {
+					disconnect();
+				}
+				return;
+			}
+
+			if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &len) || error) {
+				disconnect();
+				return;
+			}
+
+			handshake();
+		}
+		break;
+
+	case State::Handshake:
+		break;
+
+	case State::Connected:
+		if (tx_len_ == 0 && millis() - tx_ms_ >= KEEPALIVE_S * 1000UL / 2) {
+			start_packet(PINGREQ, 0);
+		}
+		break;
+	}
+
+	if (state_ != State::Connected && millis() - retry_ms_ >= RETRY_INTERVAL_MS) {
+		disconnect();
+		return;
+	}
+
+	if (!flush() || !receive()) {
+		disconnect();
+	}
+}
+
+bool MqttClient::publish(const char *topic, const char *payload, bool retain) {
+	size_t topic_len = std::strlen(topic);
+	size_t payload_len = std::strlen(payload);
+
+	if (state_ != State::Connected
+			|| !start_packet(PUBLISH | (retain ? PUBLISH_RETAIN : 0),
+				2 + topic_len + payload_len)) {
+		stats_.dropped.add();
+		return false;
+	}
+
+	append_string(topic, topic_len);
+	append(payload, payload_len);
+	stats_.published.add();
+	return true;
+}
+
+void MqttClient::connect() {
+	struct sockaddr_in addr{};
+
+	retry_ms_ = millis();
+
+	fd_ = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd_ == -1) {
+		return;
+	}
+
+	fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = address_;
+	addr.sin_port = htons(port_);
+
+	if (!::connect(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))) {
+		handshake();
+	} else if (errno == EINPROGRESS) {
+		state_ = State::Connecting;
+	} else {
+		disconnect();
+	}
+}
+
+void MqttClient::handshake() {
+	state_ = State::Handshake;
+
+	start_packet(CONNECT, 10 + 2 + sizeof(CLIENT_ID) - 1);
+	append_string("MQTT", 4);
+	append(&PROTOCOL_LEVEL, 1);
+	append(&CLEAN_SESSION, 1);
+	append_u16(KEEPALIVE_S);
+	append_string(CLIENT_ID, sizeof(CLIENT_ID) - 1);
+}
+
+void MqttClient::disconnect() {
+	if (fd_ != -1) {
+		::close(fd_);
+		fd_ = -1;
+	}
+
+	if (state_ != State::Disabled) {
+		state_ = State::Disconnected;
+	}
+
+	tx_len_ = 0;
+	rx_len_ = 0;
+	connected_.store(false, std::memory_order_relaxed);
+}
+
+bool MqttClient::start_packet(uint8_t type, size_t remaining) {
+	size_t header_len = 2;
+
+	for (size_t value = remaining; value >= 0x80; value >>= 7) {
+		header_len++;
+	}
+
+	if (header_len + remaining > tx_buffer_.size() - tx_len_) {
+		return false;
+	}
+
+	tx_buffer_[tx_len_++] = type;
+
+	do {
+		uint8_t value = remaining & 0x7F;
+
+		remaining >>= 7;
+		tx_buffer_[tx_len_++] = value | (remaining ? 0x80 : 0);
+	} while (remaining);
+
+	return true;
+}
+
+void MqttClient::append(const void *data, size_t len) {
+	std::memcpy(&tx_buffer_[tx_len_], data, len);
+	tx_len_ += len;
+}
+
+void MqttClient::append_u16(uint16_t value) {
+	tx_buffer_[tx_len_++] = value >> 8;
+	tx_buffer_[tx_len_++] = value & 0xFF;
+}
+
+void MqttClient::append_string(const char *text, size_t len) {
+	append_u16(len);
+	append(text, len);
+}
+
+bool MqttClient::flush() {
+	while (tx_len_ > 0) {
+		ssize_t len = ::send(fd_, tx_buffer_.data(), tx_len_, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+		if (len < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+
+		std::memmove(tx_buffer_.data(), &tx_buffer_[len], tx_len_ - len);
+		tx_len_ -= len;
+		tx_ms_ = millis();
+	}
+
+	return true;
+}
+
+bool MqttClient::receive() {
+	ssize_t len = ::recv(fd_, &rx_buffer_[rx_len_], rx_buffer_.size() - rx_len_, MSG_DONTWAIT);
+
+	if (len == 0) {
+		return false;
+	} else if (len < 0) {
+		return errno == EAGAIN || errno == EWOULDBLOCK;
+	}
+
+	rx_len_ += len;
+
+	/* Only CONNACK and PINGRESP are expected, which are short */
+	while (rx_len_ >= 2) {
+		size_t packet_len = 2 + rx_buffer_[1];
+
+		if (rx_buffer_[1] & 0x80 || packet_len > rx_buffer_.size()) {
+			return false;
+		} else if (rx_len_ < packet_len) {
+			break;
+		}
+
+		if (rx_buffer_[0] == CONNACK) {
+			/* Session present, return code */
+			if (packet_len != 4 || rx_buffer_[3] != 0) {
+				return false;
+			}
+
+			state_ = State::Connected;
+			tx_ms_ = millis();
+			stats_.connects.add();
+			connected_.store(true, std::memory_order_relaxed);
+		} else if (rx_buffer_[0] != PINGRESP) {
+			return false;
+		}
+
+		std::memmove(rx_buffer_.data(), &rx_buffer_[packet_len], rx_len_ - packet_len);
+		rx_len_ -= packet_len;
+	}
+
+	return true;
+}
+#endif
+
+} // namespace ggroohauga
@@ -0,0 +1,185 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/publisher.h"
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+#include <uuid/log.h>
+
+namespace ggroohauga {
+
+StatePublisher::StatePublisher(Bridge &bridge, const AmplifierModel &model,
+		const Proxy &power, const Proxy &console, const Proxy &amplifier)
+		: logger_(F("mqtt"), uuid::log::Facility::DAEMON),
+			bridge_(bridge), model_(model), power_(power),
+			console_(console), amplifier_(amplifier) {
+}
+
+void StatePublisher::start(const char *uri) {
+	started_ = client_.begin(uri);
+
+	if (!started_) {
+		logger_.err(F("Invalid broker URI: %s"), uri);
+	}
+}
+
+void StatePublisher::clear_stats() {
+	client_.clear_stats();
+	stats_.samples.clear();
+	stats_.changes.clear();
+}
+
+void StatePublisher::loop() {
+	if (!started_) {
+		return;
+	}
+
+	client_.loop();
+
+	if (!client_.connected()) {
+		published_ = false;
+		return;
+	}
+
+	if (published_ && (!changed() || millis() - publish_ms_ < INTERVAL_MS)) {
+		return;
+	}
+
+	/* Everything is published again if any messages are dropped */
+	publish_ms_ = millis();
+	published_ = publish(sample(), !published_);
+}
+
+bool StatePublisher::changed() const {
+	return model_.changes() != state_.changes
+		|| console_.changes() != state_.console.changes
+		|| amplifier_.changes() != state_.amplifier.changes
+		|| power_.changes() != state_.power.changes;
+}
+
+StatePublisher::State StatePublisher::sample() const {
+	/* Read the count first so that a change while sampling isn't missed */
+	unsigned long changes = model_.changes();
+	const auto model = model_.state();
+	const auto &status = model.status;
+	State state;
+
+	state.changes = changes;
+	state.synced = model.synced;
+	state.mute = model.mute;
+	state.input = status.input;
+	state.effect = status.effects[static_cast<size_t>(status.input)];
+	state.levels = status.levels;
+
+	std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+	state.console = {console_.on(), console_.changes()};
+	state.amplifier = {amplifier_.on(), amplifier_.changes()};
+	state.power = {power_.on(), power_.changes()};
+	return state;
+}
+
+bool StatePublisher::publish(const State &state, bool all) {
+	static const char * const LEVELS[] = {
+		"level/main", "level/rear", "level/center", "level/sub",
+	};
+	static const char * const INPUTS[] = { "1", "2", "3", "4", "5", "aux" };
+	static const char * const EFFECTS[] = { "none", "3D", "4.1", "2.1" };
+	unsigned long changes = 0;
+	bool ok = true;
+
+	stats_.samples.add();
+
+	ok &= publish("console", state.console, state_.console, all, changes);
+	ok &= publish("amplifier", state.amplifier, state_.amplifier, all, changes);
+	ok &= publish("power", state.power, state_.power, all, changes);
+
+	/* The amplifier's state isn't known until it has sent its status */
+	if (state.synced) {
+		bool changed_only = !all && state_.synced;
+
+		if (!changed_only || state.mute != state_.mute) {
+			ok &= publish("mute", state.mute);
+			changes++;
+		}
+
+		if (!changed_only || state.input != state_.input) {
+			ok &= publish("input", INPUTS[static_cast<size_t>(state.input)]);
+			changes++;
+		}
+
+		if (!changed_only || state.effect != state_.effect) {
+			ok &= publish("effect", EFFECTS[static_cast<size_t>(state.effect)]);
+			changes++;
+		}
+
+		for (size_t i = 0; i < state.levels.size(); i++) {
+			if (!changed_only || state.levels[i] != state_.levels[i]) {
+				std::array<char, 4> value;
+
+				snprintf_P(value.data(), value.size(), PSTR("%u"), state.levels[i]);
+				ok &= publish(LEVELS[i], value.data());
+				changes++;
+			}
+		}
+	}
+
+	stats_.changes.add(changes);
+	state_ = state;
+	return ok;
+}
+
+bool StatePublisher::publish(const char *topic, const Pin &pin,
+		const Pin &previous, bool all, unsigned long &changes) {
+	bool ok = true;
+
+	if (all) {
+		ok &= publish(topic, pin.on);
+		changes++;
+	} else if (pin.changes != previous.changes) {
+		if (pin.on == previous.on) {
+			/* Pulse since the last update */
+			ok &= publish(topic, !pin.on);
+			changes++;
+		}
+
+		ok &= publish(topic, pin.on);
+		changes++;
+	}
+
+	return ok;
+}
+
+bool StatePublisher::publish(const char *topic, const char *value) {
+	std::array<char, 64> name;
+
+	snprintf_P(name.data(), name.size(), PSTR("%s/%s"), GGROOHAUGA_MQTT_TOPIC, topic);
+	return client_.publish(name.data(), value, true);
+}
+
+bool StatePublisher::publish(const char *topic, bool value) {
+	return publish(topic, value ? "on" : "off");
+}
+
+} // namespace ggroohauga
@@ -0,0 +1,267 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/replay.h"
+
+#include <Arduino.h>
+
+#include <mutex>
+
+#include <uuid/log.h>
+
+namespace ggroohauga {
+
+Replay::Replay(Bridge &bridge, Device &console, Device &amplifier)
+		: logger_(F("replay"), uuid::log::Facility::UUCP),
+		bridge_(bridge), con_(console), amp_(amplifier) {
+}
+
+uint32_t Replay::hash(const uint8_t *data, size_t len) {
+	uint32_t value = 2166136261UL; /* FNV-1a */
+
+	for (size_t i = 0; i < len; i++) {
+		value = (value ^ data[i]) * 16777619UL;
+	}
+
+	return value;
+}
+
+bool Replay::start(bool fast) {
+	if (active_) {
+		return false;
+	}
+
+	if (bridge_.capture.active()) {
+		logger_.err(F("Unable to replay while capturing"));
+		return false;
+	}
+
+	Expected expected;
+
+	for (auto &queue : expected_) {
+		while (queue.pop(expected));
+	}
+
+	stats_.records.clear();
+	stats_.frames.clear();
+	stats_.pins.clear();
+	stats_.matched.clear();
+	stats_.mismatched.clear();
+	stats_.missing.clear();
+	stats_.extra.clear();
+
+	offset_ = 0;
+	position_ = 0;
+	pending_ = false;
+	finishing_ = false;
+	fast_ = fast;
+
+	if (!bridge_.capture.read(offset_, record_)) {
+		logger_.err(F("No capture to replay"));
+		return false;
+	}
+
+	offset_ = 0;
+	last_time_us_ = record_.time_us;
+	due_us_ = 0;
+	start_us_ = micros();
+
+	{
+		std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+		con_.clear_latency();
+		amp_.clear_latency();
+		bridge_.observer = this;
+	}
+
+	active_ = true;
+	logger_.info(F("Started replay (%S timing)"), fast ? F("fast") : F("original"));
+	return true;
+}
+
+void Replay::stop() {
+	if (active_) {
+		finish();
+	}
+}
+
+void Replay::loop() {
+	if (!active_) {
+		return;
+	}
+
+	if (finishing_) {
+		if (::millis() - finish_ms_ >= FINISH_DELAY_MS) {
+			finish();
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < MAX_RECORDS_PER_LOOP; i++) {
+		if (!pending_ && !next()) {
+			/* Wait for the last frame to be reported */
+			finishing_ = true;
+			finish_ms_ = ::millis();
+			return;
+		}
+
+		if (!due()) {
+			return;
+		}
+
+		inject();
+
+		if (pending_) {
+			/* Wait for the rest of the frame */
+			return;
+		}
+	}
+}
+
+bool Replay::next() {
+	pending_ = bridge_.capture.read(offset_, record_);
+
+	if (pending_) {
+		/*
+		 * Capture timestamps are 32-bit and frames are recorded with their
+		 * start time, so they can be slightly earlier than the previous record
+		 */
+		int32_t gap_us = (int32_t)((uint32_t)record_.time_us - last_time_us_);
+
+		if (fast_ && gap_us > (int32_t)FAST_MAX_GAP_US) {
+			gap_us = FAST_MAX_GAP_US;
+		}
+
+		last_time_us_ = record_.time_us;
+		due_us_ += gap_us;
+		position_ = 0;
+	}
+
+	return pending_;
+}
+
+/* Time that the next byte of the current record is due, relative to the start */
+uint32_t Replay::due_us() const {
+	return due_us_ + position_ * Device::CHAR_TIME_US;
+}
+
+bool Replay::due() const {
+	return (int32_t)((uint32_t)(micros() - start_us_) - due_us()) >= 0;
+}
+
+void Replay::inject() {
+	switch (record_.type) {
+	case Capture::RecordType::Frame: {
+			bool amplifier = record_.flags & Capture::FLAG_AMPLIFIER_TO_CONSOLE;
+			Direction direction = amplifier
+				? Direction::AmplifierToConsole : Direction::ConsoleToAmplifier;
+			uint32_t elapsed_us = micros() - start_us_;
+			uint32_t first_us = due_us();
+			size_t len = 1;
+
+			if (position_ == 0) {
+				if (!expected_[static_cast<size_t>(direction)].push({record_.length,
+						hash(record_.data.data(), record_.length)})) {
+					stats_.missing.add();
+				}
+
+				stats_.frames.add();
+			}
+
+			/* Inject all of the bytes that are due together, like a serial read */
+			while (position_ + len < record_.length
+					&& (int32_t)(elapsed_us - (first_us + len * Device::CHAR_TIME_US)) >= 0) {
+				len++;
+			}
+
+			if (position_ < record_.length) {
+				(amplifier ? amp_ : con_).inject(&record_.data[position_], len,
+					start_us_ + first_us,
+					start_us_ + first_us + (len - 1) * Device::CHAR_TIME_US);
+			}
+
+			position_ += len;
+
+			if (position_ < record_.length) {
+				return;
+			}
+			break;
+		}
+
+	case Capture::RecordType::Pin:
+		if (record_.length < 1) {
+			break;
+		}
+
+		for (Device *device : {&con_, &amp_}) {
+			for (auto *proxy : device->proxies()) {
+				if (proxy->pin() == record_.data[0]) {
+					proxy->inject((record_.flags & Capture::FLAG_HIGH)
+						? LogicValue::High : LogicValue::Low);
+					stats_.pins.add();
+				}
+			}
+		}
+		break;
+	}
+
+	pending_ = false;
+	stats_.records.add();
+}
+
+void Replay::finish() {
+	Expected expected;
+
+	{
+		std::lock_guard<std::mutex> lock{bridge_.mutex};
+
+		bridge_.observer = nullptr;
+	}
+
+	for (auto &queue : expected_) {
+		while (queue.pop(expected)) {
+			stats_.missing.add();
+		}
+	}
+
+	for (Device *device : {&con_, &amp_}) {
+		for (auto *proxy : device->proxies()) {
+			proxy->inject(LogicValue::Unknown);
+		}
+	}
+
+	active_ = false;
+	logger_.info(F("Finished replay: %lu records, %lu matched, %lu mismatched, %lu missing, %lu extra"),
+		stats_.records.get(), stats_.matched.get(), stats_.mismatched.get(),
+		stats_.missing.get(), stats_.extra.get());
+}
+
+void Replay::frame_reported(const Frame &frame) {
+	Expected expected;
+
+	if (!expected_[static_cast<size_t>(frame.direction())].pop(expected)) {
+		stats_.extra.add();
+	} else if (expected.length == frame.size()
+			&& expected.hash == hash(frame.data(), frame.size())) {
+		stats_.matched.add();
+	} else {
+		stats_.mismatched.add();
+	}
+}
+
+} // namespace ggroohauga
@@ -0,0 +1,1663 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ggroohauga/selftest.h"
+
+#ifdef GGROOHAUGA_SIMULATION
+
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ggroohauga/app.h"
+#include "ggroohauga/device.h"
+#include "ggroohauga/filter.h"
+#include "ggroohauga/fixture.h"
+#include "ggroohauga/frame.h"
+#include "ggroohauga/model.h"
+#include "ggroohauga/monitor.h"
+#include "ggroohauga/publisher.h"
+#include "ggroohauga/replay.h"
+#include "ggroohauga/sim.h"
+#include "ggroohauga/timer.h"
+#include "ggroohauga/trace.h"
+#include "ggroohauga/z906.h"
+
+#define CHECK(expr) check((expr), #expr, __FILE__, __LINE__)
+
+namespace ggroohauga {
+
+namespace selftest {
+
+static std::atomic<bool> count_allocations{false};
+static std::atomic<unsigned long> allocations{0};
+
+} // namespace selftest
+
+} // namespace ggroohauga
+
+#if GGROOHAUGA_SELFTEST
+/*
+ * Count heap allocations from all threads. The replacement operators go
+ * through these helpers, which mustn't be inlined so that the compiler
+ * doesn't see malloc() paired with a delete expression.
+ */
+__attribute__((noinline)) static void *allocate(std::size_t size) {
+	void *ptr;
+
+	if (ggroohauga::selftest::count_allocations.load(std::memory_order_relaxed)) {
+		ggroohauga::selftest::allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	ptr = std::malloc(size ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc{};
+	}
+
+	return ptr;
+}
+
+__attribute__((noinline)) static void deallocate(void *ptr) {
+	std::free(ptr);
+}
+
+void *operator new(std::size_t size) {
+	return allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+	return allocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+	deallocate(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+	deallocate(ptr);
+}
+
+void operator delete(void *ptr, std::size_t size __attribute__((unused))) noexcept {
+	deallocate(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t size __attribute__((unused))) noexcept {
+	deallocate(ptr);
+}
+#endif
+
+namespace ggroohauga {
+
+namespace selftest {
+
+struct Test {
+	const char *name;
+	void (*function)(App &app);
+};
+
+static unsigned long checks_failed = 0;
+static const char *skip_reason = nullptr;
+static bool app_started = false;
+
+static void check(bool ok, const char *expr, const char *file, int line) {
+	if (!ok) {
+		std::printf("# %s:%d: check failed: %s\n", file, line, expr);
+		checks_failed++;
+	}
+}
+
+static void skip(const char *reason) {
+	skip_reason = reason;
+}
+
+/* Report a measurement */
+static void note(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static void note(const char *format, ...) {
+	va_list ap;
+
+	std::printf("# ");
+	va_start(ap, format);
+	std::vprintf(format, ap);
+	va_end(ap);
+	std::printf("\n");
+}
+
+/* Read everything that's available from a serial port */
+static size_t read_all(HardwareSerial &serial, std::vector<uint8_t> &data) {
+	std::array<uint8_t, 256> buffer;
+	size_t total = 0;
+	size_t len;
+
+	while ((len = serial.read(buffer.data(), buffer.size())) > 0) {
+		data.insert(data.end(), buffer.begin(), buffer.begin() + len);
+		total += len;
+	}
+
+	return total;
+}
+
+/*
+ * Forward data from receive events without running the device loop, with a
+ * separate thread calling the receive callback as the serial event task.
+ * Deactivating the device while events are still happening must not
+ * deadlock.
+ */
+static void receive_event_latency(App&) {
+	static constexpr unsigned int ITERATIONS = 1000;
+	static constexpr uint64_t TIMEOUT_US = 100000;
+
+	if (!Device::RX_EVENTS) {
+		skip("receive events disabled");
+		return;
+	}
+
+	sim::manual_clock(false);
+
+	auto frame = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	sim::Fixture fixture;
+	std::atomic<bool> stop{false};
+	std::thread events{[&fixture, &stop] {
+		while (!stop.load()) {
+			fixture.con_port_.poll();
+			std::this_thread::yield();
+		}
+	}};
+	std::vector<uint8_t> received;
+	uint64_t total_us = 0;
+	uint64_t max_us = 0;
+	unsigned int timeouts = 0;
+
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		uint64_t start_us = sim::now_us();
+		uint64_t elapsed_us = 0;
+
+		received.clear();
+		fixture.con_peer_.write(frame.data(), frame.size());
+
+		while (received.size() < frame.size() && elapsed_us < TIMEOUT_US) {
+			std::this_thread::yield();
+			read_all(fixture.amp_peer_, received);
+			elapsed_us = sim::now_us() - start_us;
+		}
+
+		if (received != frame) {
+			timeouts++;
+		}
+
+		total_us += elapsed_us;
+		max_us = std::max(max_us, elapsed_us);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{fixture.bridge_.mutex};
+
+		fixture.con_.deactivate();
+	}
+
+	fixture.con_peer_.write(frame.data(), frame.size());
+	sim::advance_us(1000);
+	fixture.con_.loop();
+
+	stop = true;
+	events.join();
+
+	received.clear();
+	read_all(fixture.amp_peer_, received);
+
+	CHECK(timeouts == 0);
+	CHECK(fixture.con_.stats().rx_events.get() > 0);
+	CHECK(fixture.con_.stats().frames_forwarded.get() == ITERATIONS);
+	CHECK(received.empty());
+
+	note("receive event to forward: mean %llu µs, max %llu µs",
+		static_cast<unsigned long long>(total_us / ITERATIONS),
+		static_cast<unsigned long long>(max_us));
+}
+
+/* Frame boundaries as reported by the decoder */
+class DecodedFrames {
+public:
+	/* Returns false if the decoder reported something inconsistent */
+	bool feed(z906::Decoder &decoder, uint8_t value) {
+		buffer_.push_back(value);
+
+		switch (decoder.feed(value)) {
+		case z906::Decoder::Result::Incomplete:
+			return buffer_.size() < Frame::MAX_LEN && !decoder.idle();
+
+		case z906::Decoder::Result::Command:
+			commands++;
+			buffer_.clear();
+			return value != z906::FRAME_START;
+
+		case z906::Decoder::Result::Frame:
+			frames++;
+			if (!z906::valid_frame(buffer_.data(), buffer_.size())) {
+				return false;
+			}
+			buffer_.clear();
+			return decoder.idle();
+
+		case z906::Decoder::Result::Malformed:
+			malformed++;
+			buffer_.clear();
+			return decoder.idle();
+
+		case z906::Decoder::Result::Resync:
+			resyncs++;
+			if (decoder.restart() == 0 || decoder.restart() >= buffer_.size()
+					|| buffer_[decoder.restart()] != z906::FRAME_START
+					|| decoder.idle()) {
+				return false;
+			}
+			buffer_.erase(buffer_.begin(), buffer_.begin() + decoder.restart());
+			return true;
+		}
+
+		return false;
+	}
+
+	unsigned long commands = 0;
+	unsigned long frames = 0;
+	unsigned long malformed = 0;
+	unsigned long resyncs = 0;
+
+private:
+	std::vector<uint8_t> buffer_;
+};
+
+/* Timer with any callback, to test the scheduler */
+class TestTimer final: public Timer {
+public:
+	explicit TestTimer(std::function<void()> function)
+		: Timer(&expired), function_(std::move(function)) {}
+
+private:
+	static void expired(Timer &timer) {
+		static_cast<TestTimer&>(timer).function_();
+	}
+
+	std::function<void()> function_;
+};
+
+/*
+ * Timers started in a random order must expire in the order of their
+ * deadlines, and never early. Starting more timers than the scheduler can
+ * hold is counted as an overflow.
+ */
+static void scheduler_order(App&) {
+	sim::manual_clock(true);
+
+	Scheduler scheduler;
+	std::vector<std::unique_ptr<TestTimer>> timers;
+	std::vector<unsigned long> expired;
+	unsigned long start_us = micros();
+	unsigned int early = 0;
+	unsigned long next_us = 0;
+	auto order = sim::make_garbage(Scheduler::MAX_TIMERS);
+
+	for (size_t i = 0; i < Scheduler::MAX_TIMERS + 1; i++) {
+		unsigned long deadline_us = start_us + 1000
+			+ (i < order.size() ? order[i] : 0) * 10 + i;
+
+		timers.emplace_back(new TestTimer{[&expired, &early, deadline_us] {
+			if ((long)(micros() - deadline_us) < 0) {
+				early++;
+			}
+			expired.push_back(deadline_us);
+		}});
+		timers.back()->start(scheduler, deadline_us);
+	}
+
+	CHECK(scheduler.armed() == Scheduler::MAX_TIMERS);
+	CHECK(scheduler.overflow().get() == 1);
+	CHECK(!timers.back()->armed());
+	CHECK(scheduler.next(next_us) && next_us >= 1000);
+
+	while (scheduler.armed() > 0) {
+		sim::advance_us(7);
+		scheduler.run();
+	}
+
+	CHECK(!scheduler.next(next_us));
+	CHECK(expired.size() == Scheduler::MAX_TIMERS);
+	CHECK(std::is_sorted(expired.begin(), expired.end()));
+	CHECK(early == 0);
+}
+
+/*
+ * Cancelled timers must not expire, restarting a timer moves its deadline
+ * earlier or later, and callbacks can restart their own timer or cancel
+ * others.
+ */
+static void scheduler_cancel(App&) {
+	sim::manual_clock(true);
+
+	Scheduler scheduler;
+	unsigned int cancelled_count = 0;
+	unsigned int moved_count = 0;
+	unsigned int periodic_count = 0;
+	unsigned int victim_count = 0;
+	TestTimer cancelled{[&cancelled_count] { cancelled_count++; }};
+	TestTimer moved{[&moved_count] { moved_count++; }};
+	TestTimer victim{[&victim_count] { victim_count++; }};
+	TestTimer killer{[&victim] { victim.cancel(); }};
+	TestTimer periodic{[&] {
+		if (++periodic_count < 5) {
+			periodic.start(scheduler, micros() + 100);
+		}
+	}};
+	unsigned long start_us = micros();
+	unsigned long next_us = 0;
+
+	cancelled.start(scheduler, start_us + 100);
+	cancelled.cancel();
+	cancelled.cancel();
+	CHECK(!cancelled.armed());
+
+	moved.start(scheduler, start_us + 5000);
+	moved.start(scheduler, start_us + 200);
+	CHECK(scheduler.next(next_us) && next_us == 200);
+
+	/* Both expire in the same run, the killer first */
+	killer.start(scheduler, start_us + 300);
+	victim.start(scheduler, start_us + 301);
+	periodic.start(scheduler, start_us + 100);
+	CHECK(scheduler.armed() == 4);
+	CHECK(scheduler.next(next_us) && next_us == 100);
+
+	sim::advance_us(150);
+	scheduler.run();
+	CHECK(moved_count == 0);
+	CHECK(periodic_count == 1);
+
+	sim::advance_us(200);
+	scheduler.run();
+	CHECK(moved_count == 1);
+	CHECK(victim_count == 0);
+	CHECK(!victim.armed());
+
+	/* Move the deadline later */
+	moved.start(scheduler, micros() + 100);
+	moved.start(scheduler, micros() + 1000);
+	sim::advance_us(500);
+	scheduler.run();
+	CHECK(moved_count == 1);
+
+	for (unsigned int i = 0; i < 10; i++) {
+		sim::advance_us(100);
+		scheduler.run();
+	}
+
+	CHECK(cancelled_count == 0);
+	CHECK(moved_count == 2);
+	CHECK(periodic_count == 5);
+	CHECK(victim_count == 0);
+	CHECK(scheduler.armed() == 0);
+}
+
+/*
+ * Deadlines either side of micros() wrapping around must stay in order and
+ * the time until the next one must not jump.
+ */
+static void scheduler_wraparound(App&) {
+	sim::manual_clock(true);
+
+	/* Wrap the (64-bit on the host) clock, which isn't allowed to go backwards */
+	sim::advance_us(0 - sim::now_us() - 500);
+
+	Scheduler scheduler;
+	std::vector<int> expired;
+	TestTimer before{[&expired] { expired.push_back(1); }};
+	TestTimer after{[&expired] { expired.push_back(2); }};
+	TestTimer later{[&expired] { expired.push_back(3); }};
+	unsigned long start_us = micros();
+	unsigned long next_us = 0;
+
+	CHECK(start_us + 1000 < start_us);
+
+	later.start(scheduler, start_us + 2000);
+	after.start(scheduler, start_us + 1000);
+	before.start(scheduler, start_us + 200);
+	CHECK(scheduler.next(next_us) && next_us == 200);
+
+	sim::advance_us(300);
+	scheduler.run();
+	CHECK(expired == std::vector<int>{1});
+	CHECK(scheduler.next(next_us) && next_us == 700);
+
+	sim::advance_us(400);
+	CHECK(micros() < start_us);
+	scheduler.run();
+	CHECK(expired == std::vector<int>{1});
+	CHECK(scheduler.next(next_us) && next_us == 300);
+
+	sim::advance_us(300);
+	scheduler.run();
+	CHECK(expired == (std::vector<int>{1, 2}));
+
+	sim::advance_us(1000);
+	scheduler.run();
+	CHECK(expired == (std::vector<int>{1, 2, 3}));
+
+	/* Overdue timers have no time remaining */
+	before.start(scheduler, micros() - 100);
+	CHECK(scheduler.next(next_us) && next_us == 0);
+	scheduler.run();
+	CHECK(expired.size() == 4);
+
+	/* Go back to the real clock */
+	sim::manual_clock(false);
+}
+
+/*
+ * Feed the decoder random data with valid frames and stray frame starts
+ * mixed in, and check that everything it reports is consistent with the
+ * data. Frames that follow a stray frame start must still be found.
+ */
+static void decoder_fuzz(App&) {
+	static constexpr unsigned int ROUNDS = 2000;
+	z906::Decoder decoder;
+	DecodedFrames decoded;
+	unsigned long errors = 0;
+	unsigned long expected = 0;
+
+	for (unsigned int i = 0; i < ROUNDS; i++) {
+		auto garbage = sim::make_garbage(i % 64, i);
+		auto frame = sim::make_frame(i % 16, (i * 7) % 64);
+
+		for (auto value : garbage) {
+			errors += decoded.feed(decoder, value) ? 0 : 1;
+		}
+
+		/* Complete or abandon whatever the garbage started */
+		while (!decoder.idle()) {
+			errors += decoded.feed(decoder, 0) ? 0 : 1;
+		}
+
+		if (i % 2) {
+			errors += decoded.feed(decoder, z906::FRAME_START) ? 0 : 1;
+		}
+
+		unsigned long frames = decoded.frames;
+
+		for (auto value : frame) {
+			errors += decoded.feed(decoder, value) ? 0 : 1;
+		}
+
+		/*
+		 * A stray frame start makes the frame type its length, so it
+		 * fails its checksum before the real frame is complete unless
+		 * the real frame is shorter than its type.
+		 */
+		if (i % 2 == 0 || frame[1] <= frame[2]) {
+			expected++;
+			errors += decoded.frames == frames + 1 ? 0 : 1;
+		}
+
+		while (!decoder.idle()) {
+			errors += decoded.feed(decoder, 0) ? 0 : 1;
+		}
+	}
+
+	CHECK(errors == 0);
+	CHECK(decoded.frames >= expected);
+	CHECK(decoded.resyncs > 0);
+
+	note("%lu frames, %lu commands, %lu malformed, %lu resyncs",
+		decoded.frames, decoded.commands, decoded.malformed, decoded.resyncs);
+}
+
+/*
+ * Fuzz a device with random data and check that every received byte is
+ * reported in exactly one frame.
+ */
+static void device_fuzz(App&) {
+	class Observer: public FrameObserver {
+	public:
+		void frame_reported(const Frame &frame) override {
+			bytes += frame.size();
+		}
+
+		unsigned long bytes = 0;
+	} observer;
+
+	sim::manual_clock(true);
+
+	sim::Fixture fixture;
+	unsigned long sent = 0;
+
+	fixture.bridge_.observer = &observer;
+
+	for (uint32_t i = 0; i < 1000; i++) {
+		auto data = sim::make_garbage(1 + i % 300, i);
+
+		if (i % 3 == 0) {
+			auto frame = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+
+			data.insert(data.begin() + data.size() / 2, frame.begin(), frame.end());
+		}
+
+		fixture.amp_peer_.write(data.data(), data.size());
+		sent += data.size();
+		fixture.amp_.loop();
+		sim::advance_us(100000);
+		fixture.run_timers();
+		fixture.drain();
+	}
+
+	fixture.bridge_.observer = nullptr;
+
+	CHECK(fixture.amp_.stats().rx_bytes.get() == sent);
+	CHECK(observer.bytes == sent);
+	CHECK(fixture.amp_.stats().rx_frames.get() > 0);
+
+	note("%lu frames, %lu malformed, %lu truncated",
+		fixture.amp_.stats().frames.get(),
+		fixture.amp_.stats().rx_malformed.get(),
+		fixture.amp_.stats().rx_truncated.get());
+}
+
+/*
+ * Receive more data than the serial port can buffer while the device isn't
+ * reading it. The lost data must be counted as one overflow.
+ */
+static void receive_overflow(App&) {
+	sim::manual_clock(true);
+
+	sim::Fixture fixture;
+	auto data = sim::make_garbage(4096);
+
+	fixture.amp_peer_.write(data.data(), data.size());
+	sim::advance_us(data.size() * Device::CHAR_TIME_US);
+
+	for (unsigned int i = 0; i < 10; i++) {
+		fixture.amp_.loop();
+	}
+
+	unsigned long received = fixture.amp_.stats().rx_bytes.get();
+	unsigned long overflows = fixture.amp_.serial_stats().rx_overflows.get();
+
+	fixture.amp_peer_.write(data.data(), 100);
+	sim::advance_us(100 * Device::CHAR_TIME_US);
+	fixture.amp_.loop();
+	sim::advance_us(100000);
+	fixture.run_timers();
+	fixture.drain();
+
+	CHECK(received > 0);
+	CHECK(received < data.size());
+	CHECK(overflows == 1);
+	CHECK(fixture.amp_.stats().rx_bytes.get() == received + 100);
+	CHECK(fixture.amp_.serial_stats().rx_overflows.get() == 1);
+
+	note("%lu of %zu bytes received, %lu overflows", received, data.size(), overflows);
+}
+
+/*
+ * Send single byte commands and measure the time from the last byte being
+ * received to the end of the frame. It must end after the receive line has
+ * been idle (or at the report timeout, if that's disabled).
+ */
+static void frame_end_latency(App&) {
+	static constexpr unsigned int ITERATIONS = 20;
+	static constexpr unsigned long STEP_US = 100;
+	static constexpr unsigned long TIMEOUT_US = 100000;
+	static constexpr std::array<uint8_t, 1> command{0x11};
+	unsigned long expected_us = Device::RX_IDLE_US
+		? Device::RX_IDLE_US : Device::MAX_REPORT_DELAY_MS * 1000;
+
+	sim::manual_clock(true);
+
+	sim::Fixture fixture;
+	const auto &stats = fixture.con_.stats();
+
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		unsigned long frames = stats.frames.get();
+		unsigned long elapsed_us = 0;
+
+		fixture.con_peer_.write(command.data(), command.size());
+
+		while (stats.frames.get() == frames && elapsed_us < TIMEOUT_US) {
+			sim::advance_us(STEP_US);
+			elapsed_us += STEP_US;
+			fixture.con_.loop();
+			fixture.run_timers();
+		}
+
+		fixture.drain();
+	}
+
+	const auto &boundary = stats.boundary_us;
+
+	CHECK(stats.frames.get() == ITERATIONS);
+	CHECK(boundary.count() == ITERATIONS);
+	CHECK(boundary.percentile(50) >= expected_us);
+	CHECK(boundary.max() <= expected_us + STEP_US);
+	if (Device::RX_IDLE_US) {
+		CHECK(stats.frames_idle.get() == ITERATIONS);
+	} else {
+		CHECK(stats.frames_timeout.get() == ITERATIONS);
+	}
+
+	note("frame end: p50 %lu µs, max %lu µs (%s, %lu µs loop)",
+		boundary.percentile(50), boundary.max(),
+		Device::RX_IDLE_US ? "idle detection" : "report timeout only",
+		STEP_US);
+}
+
+/*
+ * The filters must follow the decoder's message boundaries when a frame is
+ * cut short by a report or when the decoder resyncs to a frame start inside
+ * a malformed frame, so that a blocked command that follows is still
+ * dropped. Only the data that's actually forwarded is counted.
+ */
+static void filter_boundaries(App&) {
+	const uint8_t blocked = z906::input_opcode(z906::Input::Input1);
+	auto frame = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	std::vector<uint8_t> forwarded;
+	std::vector<uint8_t> replies;
+	std::vector<uint8_t> expected;
+
+	sim::manual_clock(true);
+
+	sim::Fixture fixture;
+	InputBlocker blocker;
+	const auto &stats = fixture.con_.stats();
+
+	fixture.bridge_.filters.add(blocker);
+	blocker.input(static_cast<int>(z906::Input::Input1));
+
+	auto send = [&fixture] (const uint8_t *data, size_t len) {
+		fixture.con_peer_.write(data, len);
+		sim::advance_us(len * Device::CHAR_TIME_US);
+		fixture.con_.loop();
+	};
+
+	/* Frame header, interrupted by a pin change */
+	send(frame.data(), z906::FRAME_HEADER_LEN);
+	fixture.con_.report_both();
+	send(&blocked, 1);
+	expected.insert(expected.end(), frame.begin(), frame.begin() + z906::FRAME_HEADER_LEN);
+
+	/* Malformed frame with the start of another frame inside it */
+	const std::array<uint8_t, 6> malformed{z906::FRAME_START, 0x01, 2, 0x00,
+		z906::FRAME_START, 0x00};
+
+	send(malformed.data(), malformed.size());
+	send(&frame[1], frame.size() - 1);
+	send(&blocked, 1);
+	expected.insert(expected.end(), malformed.begin(), malformed.end());
+	expected.insert(expected.end(), frame.begin() + 1, frame.end());
+
+	sim::advance_us(100000);
+	fixture.run_timers();
+	read_all(fixture.amp_peer_, forwarded);
+	read_all(fixture.con_peer_, replies);
+
+	CHECK(forwarded == expected);
+	CHECK(replies == std::vector<uint8_t>(2, blocked));
+	CHECK(blocker.stats().dropped.get() == 2);
+	CHECK(stats.tx_bytes.get() == forwarded.size());
+	CHECK(stats.latency_us.count() == stats.tx_calls.get());
+}
+
+/*
+ * The level limiter can't let level increases through until it knows the
+ * level, and levels reported by the amplifier above the maximum are clamped
+ * so that a level decrease brings them back under the limit.
+ */
+static void level_limiter(App&) {
+	const uint8_t up = z906::level_opcode(z906::Channel::Main, true);
+	const uint8_t down = z906::level_opcode(z906::Channel::Main, false);
+	auto status = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	std::vector<uint8_t> forwarded;
+	std::vector<uint8_t> replies;
+
+	sim::manual_clock(true);
+
+	sim::Fixture fixture;
+	LevelLimiter limiter{z906::Channel::Main};
+
+	fixture.bridge_.filters.add(limiter);
+	limiter.limit(z906::Status::MAX_LEVEL);
+
+	auto send = [&fixture] (HardwareSerial &peer, auto &device,
+			const uint8_t *data, size_t len) {
+		peer.write(data, len);
+		sim::advance_us(len * Device::CHAR_TIME_US);
+		device.loop();
+		sim::advance_us(100000);
+		fixture.run_timers();
+	};
+
+	/* Level unknown */
+	send(fixture.con_peer_, fixture.con_, &up, 1);
+	read_all(fixture.amp_peer_, forwarded);
+	read_all(fixture.con_peer_, replies);
+	CHECK(forwarded.empty());
+	CHECK(replies == std::vector<uint8_t>{up});
+
+	/* Status with an out of range level, followed by a decrease */
+	status[z906::FRAME_HEADER_LEN + static_cast<size_t>(z906::Channel::Main)] = 200;
+	status.back() = z906::checksum(status.data(), status.size());
+	send(fixture.amp_peer_, fixture.amp_, status.data(), status.size());
+	send(fixture.amp_peer_, fixture.amp_, &down, 1);
+
+	replies.clear();
+	read_all(fixture.con_peer_, replies);
+	send(fixture.con_peer_, fixture.con_, &up, 1);
+	send(fixture.con_peer_, fixture.con_, &up, 1);
+	read_all(fixture.amp_peer_, forwarded);
+	replies.clear();
+	read_all(fixture.con_peer_, replies);
+	CHECK(forwarded == std::vector<uint8_t>{up});
+	CHECK(replies == std::vector<uint8_t>{up});
+	CHECK(limiter.stats().dropped.get() == 2);
+}
+
+/*
+ * When the model answers the console, only the amplifier's reply to a query
+ * that the model can't answer is passed through. Its echo of a command that
+ * the model has already acknowledged and its reply to the model's own status
+ * poll (which is in flight at the same time) aren't.
+ */
+static void model_pass_through(App&) {
+	const uint8_t command = z906::input_opcode(z906::Input::Input2);
+	const uint8_t query = 0x40; /* Unknown */
+	const auto status = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	std::vector<uint8_t> polled;
+	std::vector<uint8_t> forwarded;
+	std::vector<uint8_t> replies;
+
+	sim::manual_clock(true);
+
+	sim::Fixture fixture;
+	AmplifierModel model{fixture.bridge_, fixture.con_, fixture.amp_};
+
+	auto send = [] (HardwareSerial &peer, std::initializer_list<uint8_t> data) {
+		peer.write(data.begin(), data.size());
+		sim::advance_us(data.size() * Device::CHAR_TIME_US);
+	};
+
+	model.start();
+	model.enable(true);
+	fixture.amp_.loop();
+	read_all(fixture.amp_peer_, polled);
+	CHECK(polled == std::vector<uint8_t>{z906::query_opcode(z906::Query::Status)});
+
+	send(fixture.con_peer_, {command, query});
+	fixture.con_.loop();
+	read_all(fixture.amp_peer_, forwarded);
+	read_all(fixture.con_peer_, replies);
+	CHECK(forwarded == (std::vector<uint8_t>{command, query}));
+	CHECK(replies == std::vector<uint8_t>{command});
+
+	/* Echo of the acknowledged command and the reply to the query */
+	replies.clear();
+	send(fixture.amp_peer_, {command, query});
+	fixture.amp_.loop();
+	read_all(fixture.con_peer_, replies);
+	CHECK(replies == std::vector<uint8_t>{query});
+
+	/* Reply to the status poll */
+	replies.clear();
+	fixture.amp_peer_.write(status.data(), status.size());
+	sim::advance_us(status.size() * Device::CHAR_TIME_US);
+	fixture.amp_.loop();
+	sim::advance_us(100000);
+	fixture.run_timers();
+	read_all(fixture.con_peer_, replies);
+	CHECK(replies.empty());
+	CHECK(model.state().synced);
+	CHECK(model.stats().pass_through.get() == 1);
+	CHECK(fixture.amp_.stats().frames_forwarded.get() == 1);
+}
+
+/*
+ * Commands for the amplifier must wait until a frame that's being forwarded
+ * to it from the console has finished.
+ */
+static void command_interleave(App&) {
+	const uint8_t poll = z906::query_opcode(z906::Query::Status);
+	const auto frame = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	const size_t half = frame.size() / 2;
+	std::vector<uint8_t> expected{frame.begin(), frame.end()};
+	std::vector<uint8_t> forwarded;
+
+	sim::manual_clock(true);
+
+	sim::Fixture fixture;
+
+	expected.push_back(poll);
+
+	fixture.con_peer_.write(frame.data(), half);
+	sim::advance_us(half * Device::CHAR_TIME_US);
+	fixture.con_.loop();
+
+	CHECK(fixture.amp_.submit(poll, nullptr));
+	fixture.amp_.loop();
+	CHECK(fixture.amp_.command_stats().sent.get() == 0);
+
+	fixture.con_peer_.write(&frame[half], frame.size() - half);
+	sim::advance_us((frame.size() - half) * Device::CHAR_TIME_US);
+	fixture.con_.loop();
+	fixture.amp_.loop();
+	CHECK(fixture.amp_.command_stats().sent.get() == 1);
+
+	read_all(fixture.amp_peer_, forwarded);
+	CHECK(forwarded == expected);
+}
+
+/*
+ * Frames that are all command bytes have an annotation longer than a trace
+ * line, but every record must still have some of the data so that
+ * formatting the frame ends. The same applies to frames from a shell
+ * monitor.
+ */
+static void trace_long_frames(App&) {
+	const uint8_t known = z906::input_opcode(z906::Input::Input1);
+	sim::Fixture fixture;
+	sim::TraceHandler trace;
+	FrameMonitor monitor{fixture.bridge_, true, true, FrameMonitor::ANY_OPCODE};
+	Frame monitored;
+	unsigned long records = 0;
+
+	CHECK(monitor.start());
+
+	for (uint8_t value : {known, static_cast<uint8_t>(0x40) /* Unknown */}) {
+		for (bool discarded : {false, true}) {
+			Frame frame;
+			TraceLine line;
+			size_t pos = 0;
+			size_t passes = 0;
+
+			frame.start(Direction::ConsoleToAmplifier, 1234567, 0);
+			while (!frame.full()) {
+				frame.push_back(value);
+			}
+			frame.discarded(discarded);
+
+			do {
+				size_t next = format_frame(line, frame, pos);
+
+				CHECK(next > pos);
+				CHECK(line.size() <= TraceLine::MAX_LEN);
+				CHECK(!discarded || std::strstr(line.c_str(), " [discarded]"));
+				pos = next;
+				passes++;
+			} while (pos < frame.size() && passes <= frame.size());
+
+			CHECK(pos == frame.size());
+			records += passes;
+
+			fixture.con_.log_frame(frame, TraceFormat::Decoded);
+			monitor.frame_reported(frame);
+		}
+	}
+
+	while (monitor.pop(monitored)) {
+		TraceLine line;
+		size_t pos = 0;
+
+		CHECK(monitored.size() == Frame::MAX_LEN);
+
+		do {
+			size_t next = format_frame(line, monitored, pos);
+
+			CHECK(next > pos);
+			if (next == pos) {
+				break;
+			}
+			pos = next;
+			records++;
+		} while (pos < monitored.size());
+
+		CHECK(pos == monitored.size());
+	}
+
+	CHECK(monitor.stats().frames.get() == 4);
+	CHECK(monitor.new_drops() == 0);
+	note("%lu records", records);
+}
+
+/*
+ * MQTT broker that accepts one client on a local port and records the
+ * messages it publishes
+ */
+class StandInBroker {
+public:
+	using Message = std::pair<std::string, std::string>;
+
+	StandInBroker() {
+		struct sockaddr_in addr{};
+		socklen_t len = sizeof(addr);
+
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+		if (listen_fd_ == -1
+				|| bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))
+				|| listen(listen_fd_, 1)
+				|| getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len)) {
+			return;
+		}
+
+		port_ = ntohs(addr.sin_port);
+		thread_ = std::thread{[this] { run(); }};
+	}
+
+	~StandInBroker() {
+		if (listen_fd_ != -1) {
+			/* Interrupt accept() or recv() */
+			shutdown(listen_fd_, SHUT_RDWR);
+			if (client_fd_ != -1) {
+				shutdown(client_fd_, SHUT_RDWR);
+			}
+		}
+
+		if (thread_.joinable()) {
+			thread_.join();
+		}
+
+		if (listen_fd_ != -1) {
+			close(listen_fd_);
+		}
+	}
+
+	StandInBroker(const StandInBroker&) = delete;
+	StandInBroker& operator=(const StandInBroker&) = delete;
+
+	inline bool listening() const { return port_ != 0; }
+	inline std::string uri() const { return "mqtt://127.0.0.1:" + std::to_string(port_); }
+
+	std::vector<Message> messages() const {
+		std::lock_guard<std::mutex> lock{mutex_};
+
+		return messages_;
+	}
+
+private:
+	void run() {
+		std::vector<uint8_t> data;
+		std::array<uint8_t, 256> buffer;
+		ssize_t len;
+
+		client_fd_ = accept(listen_fd_, nullptr, nullptr);
+		if (client_fd_ == -1) {
+			return;
+		}
+
+		while ((len = recv(client_fd_, buffer.data(), buffer.size(), 0)) > 0) {
+			data.insert(data.end(), buffer.begin(), buffer.begin() + len);
+
+			while (packet(data));
+		}
+
+		close(client_fd_);
+	}
+
+	/* Returns true if a whole packet was removed from the data */
+	bool packet(std::vector<uint8_t> &data) {
+		size_t header_len = 1;
+		size_t remaining = 0;
+
+		do {
+			if (header_len >= data.size()) {
+				return false;
+			}
+
+			remaining |= (data[header_len] & 0x7F) << (7 * (header_len - 1));
+		} while (data[header_len++] & 0x80);
+
+		if (data.size() < header_len + remaining) {
+			return false;
+		}
+
+		const uint8_t *payload = &data[header_len];
+
+		switch (data[0] & 0xF0) {
+		case 0x10: /* CONNECT */
+			reply({0x20, 0x02, 0x00, 0x00});
+			break;
+
+		case 0x30: /* PUBLISH (QoS 0) */
+			if (remaining >= 2) {
+				size_t topic_len = (payload[0] << 8) | payload[1];
+				std::lock_guard<std::mutex> lock{mutex_};
+
+				messages_.emplace_back(
+					std::string{reinterpret_cast<const char*>(&payload[2]), topic_len},
+					std::string{reinterpret_cast<const char*>(&payload[2 + topic_len]),
+						remaining - 2 - topic_len});
+			}
+			break;
+
+		case 0xC0: /* PINGREQ */
+			reply({0xD0, 0x00});
+			break;
+		}
+
+		data.erase(data.begin(), data.begin() + header_len + remaining);
+		return true;
+	}
+
+	void reply(const std::vector<uint8_t> &data) {
+		send(client_fd_, data.data(), data.size(), MSG_NOSIGNAL);
+	}
+
+	int listen_fd_ = -1;
+	std::atomic<int> client_fd_{-1};
+	uint16_t port_ = 0;
+	std::thread thread_;
+	mutable std::mutex mutex_;
+	std::vector<Message> messages_;
+};
+
+/*
+ * Publish state to a stand-in broker. A pin that turns on and off again
+ * between updates must be published as a pulse, and updates must be no
+ * more frequent than the publish interval.
+ */
+static void mqtt_publish(App&) {
+	using Message = StandInBroker::Message;
+	static constexpr unsigned long TIMEOUT_MS = 2000;
+
+	sim::manual_clock(true);
+
+	StandInBroker broker;
+
+	if (!broker.listening()) {
+		skip("unable to listen on a local port");
+		return;
+	}
+
+	sim::Fixture fixture;
+	AmplifierModel model{fixture.bridge_, fixture.con_, fixture.amp_};
+	BasicProxy<> console{F("console"), F("in"), 47, LogicValue::Low, 0, 0, F("out"), 48, false};
+	BasicProxy<> amplifier{F("amplifier"), F("in"), 47, LogicValue::Low, 0, 0, F("out"), 48, false};
+	StatePublisher publisher{fixture.bridge_, model, fixture.detect_, console, amplifier};
+	const std::string topic = GGROOHAUGA_MQTT_TOPIC "/power";
+
+	auto run_until = [&] (size_t count) {
+		auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds{TIMEOUT_MS};
+		std::vector<Message> messages;
+
+		do {
+			publisher.loop();
+			std::this_thread::sleep_for(std::chrono::milliseconds{1});
+			messages = broker.messages();
+		} while (messages.size() < count && std::chrono::steady_clock::now() < timeout);
+
+		return messages.size();
+	};
+
+	auto pulse = [&fixture] {
+		sim::drive(sim::Fixture::DETECT_PIN, LOW);
+		fixture.con_.loop();
+		sim::advance_us(10000);
+		fixture.run_timers();
+		sim::drive(sim::Fixture::DETECT_PIN, HIGH);
+		fixture.con_.loop();
+		sim::advance_us(1000);
+	};
+
+	sim::drive(sim::Fixture::DETECT_PIN, HIGH);
+	fixture.con_.loop();
+	publisher.start(broker.uri().c_str());
+
+	/* Everything is published when connected */
+	size_t initial = run_until(3);
+
+	sim::advance_us(StatePublisher::INTERVAL_MS * 1000);
+	pulse();
+	size_t first = run_until(initial + 2);
+
+	/* The next pulse is too soon */
+	pulse();
+	size_t limited = run_until(first + 1);
+
+	sim::advance_us(StatePublisher::INTERVAL_MS * 1000);
+	size_t second = run_until(first + 2);
+
+	/* Nothing else has changed */
+	sim::advance_us(StatePublisher::INTERVAL_MS * 1000);
+	size_t last = run_until(second + 1);
+
+	sim::drive(sim::Fixture::DETECT_PIN, -1);
+
+	std::vector<Message> expected{
+		{topic, "off"},
+		{topic, "on"}, {topic, "off"},
+		{topic, "on"}, {topic, "off"},
+	};
+	std::vector<Message> power;
+
+	for (const auto &message : broker.messages()) {
+		if (message.first == topic) {
+			power.push_back(message);
+		}
+	}
+
+	CHECK(initial == 3);
+	CHECK(first == initial + 2);
+	CHECK(limited == first);
+	CHECK(second == first + 2);
+	CHECK(last == second);
+	CHECK(power == expected);
+	CHECK(publisher.client().stats().dropped.get() == 0);
+
+	note("%zu messages published, %lu samples",
+		last, publisher.stats().samples.get());
+}
+
+/*
+ * Capture traffic received one byte at a time at the speed of the bus, then
+ * replay it and check that the device finds the same frame boundaries.
+ */
+static void replay_frames(App&) {
+	const std::array<uint8_t, 1> query{z906::query_opcode(z906::Query::Status)};
+	static constexpr unsigned long STEP_US = Device::CHAR_TIME_US / 4;
+
+	sim::manual_clock(true);
+
+	auto reply = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	auto garbage = sim::make_garbage(40);
+	sim::Fixture fixture;
+	auto run = [&fixture] (unsigned long time_us) {
+		for (unsigned long i = 0; i < time_us; i += STEP_US) {
+			sim::advance_us(STEP_US);
+			fixture.con_.loop();
+			fixture.amp_.loop();
+			fixture.run_timers();
+			fixture.drain();
+		}
+	};
+	auto send = [&run] (HardwareSerial &peer, const uint8_t *data, size_t len) {
+		for (size_t i = 0; i < len; i++) {
+			peer.write(&data[i], 1);
+			run(Device::CHAR_TIME_US);
+		}
+	};
+
+	CHECK(fixture.bridge_.capture.start());
+	sim::drive(sim::Fixture::DETECT_PIN, HIGH);
+
+	for (unsigned int i = 0; i < 20; i++) {
+		send(fixture.con_peer_, query.data(), query.size());
+		run(2000);
+		send(fixture.amp_peer_, reply.data(), reply.size());
+		run(10000);
+
+		if (i % 4 == 0) {
+			send(fixture.amp_peer_, garbage.data(), garbage.size() - i);
+			run(60000);
+		}
+
+		if (i == 10) {
+			sim::drive(sim::Fixture::DETECT_PIN, LOW);
+			run(20000);
+		}
+	}
+
+	sim::drive(sim::Fixture::DETECT_PIN, -1);
+	run(100000);
+	fixture.bridge_.capture.stop();
+
+	unsigned long frames = fixture.con_.stats().frames.get()
+		+ fixture.amp_.stats().frames.get();
+	Replay replay{fixture.bridge_, fixture.con_, fixture.amp_};
+	unsigned int loops = 0;
+
+	CHECK(replay.start(false));
+
+	while (replay.active() && loops++ < 1000000) {
+		replay.loop();
+		run(STEP_US);
+	}
+
+	CHECK(!replay.active());
+	CHECK(replay.stats().frames.get() == frames);
+	CHECK(replay.stats().pins.get() >= 2);
+	CHECK(replay.stats().matched.get() == frames);
+	CHECK(replay.stats().mismatched.get() == 0);
+	CHECK(replay.stats().missing.get() == 0);
+	CHECK(replay.stats().extra.get() == 0);
+
+	note("%lu frames, %lu matched, %lu mismatched, %lu missing, %lu extra",
+		replay.stats().frames.get(), replay.stats().matched.get(),
+		replay.stats().mismatched.get(), replay.stats().missing.get(),
+		replay.stats().extra.get());
+
+	std::remove("capture.bin");
+	std::remove("capture.old");
+}
+
+/* Decode status frames and commands as fast as possible */
+static void decoder_throughput(App&) {
+	static constexpr unsigned int ROUNDS = 20000;
+	auto frame = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	auto garbage = sim::make_garbage(256);
+	z906::Decoder decoder;
+	unsigned long frames = 0;
+	unsigned long bytes = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < ROUNDS; i++) {
+		for (auto value : frame) {
+			frames += decoder.feed(value) == z906::Decoder::Result::Frame ? 1 : 0;
+		}
+
+		for (auto value : garbage) {
+			decoder.feed(value);
+		}
+
+		decoder.reset();
+		bytes += frame.size() + garbage.size();
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start).count();
+
+	CHECK(frames == ROUNDS);
+
+	note("%.1f ns per byte (%.0f times the line rate)",
+		static_cast<double>(elapsed) / bytes,
+		Device::CHAR_TIME_US * 1000.0 * bytes / std::max<int64_t>(elapsed, 1));
+}
+
+/*
+ * The application can only be started once (and then can't be stopped), so
+ * tests that use it share the same instance.
+ */
+static void start_app(App &app) {
+	if (app_started) {
+		return;
+	}
+
+	app.start();
+	app_started = true;
+
+	sim::console.pacing(false);
+	sim::amplifier.pacing(false);
+	sim::console.begin(Device::BAUD_RATE, Device::UART_CONFIG);
+	sim::amplifier.begin(Device::BAUD_RATE, Device::UART_CONFIG);
+}
+
+/*
+ * Run the application with traffic in both directions while the amplifier
+ * power is switched on and off, monitors are added and removed, and frames
+ * are logged. Everything that's handed over between the bridge and the main
+ * loop is exercised at the same time, for ThreadSanitizer to check.
+ */
+static void bridge_handoff_stress(App &app) {
+	static constexpr uint64_t DURATION_US = 2000000;
+	const std::array<uint8_t, 1> query{z906::query_opcode(z906::Query::Status)};
+
+	if (!Bridge::CONCURRENT) {
+		skip("devices only used from one context");
+		return;
+	}
+
+	sim::manual_clock(false);
+
+	sim::TraceHandler trace;
+	auto reply = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	uint8_t power_pin = app.amplifier().proxies()[1].pin();
+	std::atomic<bool> stop{false};
+
+	start_app(app);
+
+	std::thread traffic{[&reply, &query, &stop, power_pin] {
+		std::vector<uint8_t> discard;
+		unsigned int i = 0;
+
+		while (!stop.load()) {
+			if (i % 64 == 0) {
+				sim::drive(power_pin, (i / 64) % 2 ? LOW : HIGH);
+			}
+
+			sim::console.write(query.data(), query.size());
+			sim::amplifier.write(reply.data(), reply.size());
+
+			/* Serial event task */
+			if (Device::RX_EVENTS) {
+				sim::poll();
+			}
+
+			discard.clear();
+			read_all(sim::console, discard);
+			read_all(sim::amplifier, discard);
+			std::this_thread::sleep_for(std::chrono::microseconds{200});
+			i++;
+		}
+
+		sim::drive(power_pin, -1);
+	}};
+
+	uint64_t start_us = sim::now_us();
+	std::shared_ptr<FrameMonitor> monitor;
+	Frame frame;
+	unsigned long monitored = 0;
+	unsigned int i = 0;
+
+	while (sim::now_us() - start_us < DURATION_US) {
+		app.loop();
+
+		if (i % 32 == 0) {
+			monitor = monitor ? nullptr : app.monitor(true, true, FrameMonitor::ANY_OPCODE);
+		}
+
+		while (monitor && monitor->pop(frame)) {
+			monitored++;
+		}
+
+		app.model().state();
+		std::this_thread::yield();
+		i++;
+	}
+
+	stop = true;
+	traffic.join();
+	monitor.reset();
+
+	CHECK(app.console().stats().frames.get() > 0);
+	CHECK(app.amplifier().stats().frames.get() > 0);
+	CHECK(app.console().stats().activations.get() > 1);
+	CHECK(monitored > 0);
+
+	note("%lu console frames, %lu amplifier frames, %lu activations, %lu monitored",
+		app.console().stats().frames.get(), app.amplifier().stats().frames.get(),
+		app.console().stats().activations.get(), monitored);
+}
+
+/* Run the application until a device (which may be in the bridge task) has received data */
+static void receive(App &app, const Device &device, unsigned long rx_bytes) {
+	auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds{1};
+
+	do {
+		app.loop();
+		std::this_thread::yield();
+	} while (device.stats().rx_bytes.get() < rx_bytes
+		&& std::chrono::steady_clock::now() < timeout);
+}
+
+/* Send a status query from the console and reply to it from the amplifier */
+static void status_query(App &app, const std::vector<uint8_t> &reply) {
+	const std::array<uint8_t, 1> query{z906::query_opcode(z906::Query::Status)};
+	std::array<uint8_t, 256> buffer;
+	unsigned long con_bytes = app.console().stats().rx_bytes.get() + query.size();
+	unsigned long amp_bytes = app.amplifier().stats().rx_bytes.get() + reply.size();
+
+	sim::console.write(query.data(), query.size());
+	if (Device::RX_EVENTS) {
+		Serial1.poll();
+	}
+	receive(app, app.console(), con_bytes);
+
+	while (sim::amplifier.read(buffer.data(), buffer.size()) > 0);
+	sim::amplifier.write(reply.data(), reply.size());
+	if (Device::RX_EVENTS) {
+		Serial2.poll();
+	}
+	receive(app, app.amplifier(), amp_bytes);
+
+	while (sim::console.read(buffer.data(), buffer.size()) > 0);
+	sim::advance_us(1000);
+}
+
+/*
+ * Forward status queries and replies through the whole application, which
+ * must not allocate anything from the heap once it has started.
+ */
+static void no_heap_allocations(App &app) {
+	static constexpr unsigned int ITERATIONS = 1000;
+	auto reply = sim::make_frame(z906::STATUS_TYPE, z906::STATUS_LEN);
+	uint8_t power_pin = app.amplifier().proxies()[1].pin();
+
+	sim::manual_clock(true);
+	start_app(app);
+	sim::drive(power_pin, HIGH);
+
+	for (unsigned int i = 0; i < 100; i++) {
+		status_query(app, reply);
+	}
+
+	unsigned long frames = app.console().stats().frames.get();
+
+	allocations = 0;
+	count_allocations = true;
+
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		status_query(app, reply);
+	}
+
+	count_allocations = false;
+	frames = app.console().stats().frames.get() - frames;
+	sim::drive(power_pin, -1);
+
+	CHECK(frames >= ITERATIONS);
+	CHECK(allocations.load() == 0);
+
+	note("%lu allocations while receiving %lu queries",
+		allocations.load(), frames);
+}
+
+/* CPU time used by the calling thread */
+static uint64_t thread_cpu_us() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/*
+ * Measure how much CPU time the main loop uses while there's no activity,
+ * and how long it takes to forward data received while it's waiting. The
+ * wait must end within one character time of a notification.
+ */
+static void idle_wait(App &app) {
+	static constexpr uint64_t IDLE_US = 1000000;
+	static constexpr unsigned int ITERATIONS = 200;
+	static constexpr uint64_t TIMEOUT_US = 100000;
+	const std::array<uint8_t, 1> query{z906::query_opcode(z906::Query::Status)};
+
+	if (!App::IDLE_WAIT) {
+		skip("idle wait disabled");
+		return;
+	}
+
+	sim::manual_clock(false);
+	start_app(app);
+
+	uint8_t power_pin = app.amplifier().proxies()[1].pin();
+	std::atomic<bool> stop{false};
+	std::atomic<bool> running{true};
+
+	sim::drive(power_pin, HIGH);
+
+	/* Serial event task */
+	std::thread events{[&stop] {
+		while (!stop.load()) {
+			sim::poll();
+			std::this_thread::sleep_for(std::chrono::microseconds{20});
+		}
+	}};
+
+	std::thread main_loop{[&app, &running] {
+		while (running.load()) {
+			app.loop();
+		}
+	}};
+
+	std::vector<uint8_t> received;
+
+	/* Let the pin changes settle */
+	std::this_thread::sleep_for(std::chrono::milliseconds{100});
+	app.clear_stats();
+
+	uint64_t total_us = 0;
+	uint64_t max_us = 0;
+	unsigned int timeouts = 0;
+
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		/* Wait for the main loop to be idle again */
+		std::this_thread::sleep_for(std::chrono::milliseconds{2});
+
+		uint64_t start_us = sim::now_us();
+		uint64_t elapsed_us = 0;
+
+		received.clear();
+		sim::console.write(query.data(), query.size());
+
+		while (received.empty() && elapsed_us < TIMEOUT_US) {
+			std::this_thread::yield();
+			read_all(sim::amplifier, received);
+			elapsed_us = sim::now_us() - start_us;
+		}
+
+		if (received.empty()) {
+			timeouts++;
+		}
+
+		total_us += elapsed_us;
+		max_us = std::max(max_us, elapsed_us);
+	}
+
+	/* Receive events notify the bridge */
+	const auto &wakeup = app.bridge_wakeup().stats();
+	unsigned long wakeups = wakeup.wakeups.get();
+	unsigned long wake_p50_us = wakeup.latency_us.percentile(50);
+	unsigned long wake_p99_us = wakeup.latency_us.percentile(99);
+
+	running = false;
+	main_loop.join();
+
+	/* Measure the main loop in this thread while nothing is happening */
+	uint64_t cpu_us = thread_cpu_us();
+	uint64_t start_us = sim::now_us();
+
+	app.clear_stats();
+
+	while (sim::now_us() - start_us < IDLE_US) {
+		app.loop();
+	}
+
+	cpu_us = thread_cpu_us() - cpu_us;
+	uint64_t elapsed_us = sim::now_us() - start_us;
+	unsigned long idle = app.wakeup().idle_permille();
+
+	stop = true;
+	events.join();
+	sim::drive(power_pin, -1);
+	read_all(sim::amplifier, received);
+
+	CHECK(timeouts == 0);
+	CHECK(wakeups > 0);
+	CHECK(cpu_us * 10 < elapsed_us);
+
+	note("idle main loop: %.2f%% CPU, %lu.%lu%% waiting",
+		100.0 * cpu_us / elapsed_us, idle / 10, idle % 10);
+	note("receive to forward: mean %llu µs, max %llu µs",
+		static_cast<unsigned long long>(total_us / ITERATIONS),
+		static_cast<unsigned long long>(max_us));
+	note("wake latency: p50 %lu µs, p99 %lu µs (character time %lu µs)",
+		wake_p50_us, wake_p99_us, Device::CHAR_TIME_US);
+}
+
+int run(App &app) {
+	static const std::array<Test, 19> tests{{
+		{"scheduler_order", scheduler_order},
+		{"scheduler_cancel", scheduler_cancel},
+		{"scheduler_wraparound", scheduler_wraparound},
+		{"decoder_fuzz", decoder_fuzz},
+		{"decoder_throughput", decoder_throughput},
+		{"device_fuzz", device_fuzz},
+		{"receive_overflow", receive_overflow},
+		{"frame_end_latency", frame_end_latency},
+		{"filter_boundaries", filter_boundaries},
+		{"level_limiter", level_limiter},
+		{"trace_long_frames", trace_long_frames},
+		{"model_pass_through", model_pass_through},
+		{"command_interleave", command_interleave},
+		{"mqtt_publish", mqtt_publish},
+		{"replay_frames", replay_frames},
+		{"receive_event_latency", receive_event_latency},
+		{"bridge_handoff_stress", bridge_handoff_stress},
+		{"no_heap_allocations", no_heap_allocations},
+		{"idle_wait", idle_wait},
+	}};
+	unsigned int failed = 0;
+
+	std::printf("1..%zu\n", tests.size());
+
+	for (size_t i = 0; i < tests.size(); i++) {
+		unsigned long before = checks_failed;
+
+		skip_reason = nullptr;
+		tests[i].function(app);
+
+		if (checks_failed != before) {
+			std::printf("not ok %zu - %s\n", i + 1, tests[i].name);
+			failed++;
+		} else if (skip_reason) {
+			std::printf("ok %zu - %s # SKIP %s\n", i + 1, tests[i].name, skip_reason);
+		} else {
+			std::printf("ok %zu - %s\n", i + 1, tests[i].name);
+		}
+		std::fflush(stdout);
+	}
+
+	if (app_started) {
+		/* The bridge and capture tasks can't be stopped, so exit without destroying them */
+		std::fflush(stdout);
+		std::_Exit(failed ? 1 : 0);
+	}
+
+	return failed ? 1 : 0;
+}
+
+} // namespace selftest
+
+} // namespace ggroohauga
+
+#endif
@@ -0,0 +1,419 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef GGROOHAUGA_SIMULATION
+
+#include "ggroohauga/sim.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ggroohauga {
+
+namespace sim {
+
+static constexpr size_t NUM_PINS = 49;
+
+struct Pin {
+	uint8_t mode = INPUT;
+	int output = LOW;
+	int drive = -1;
+	void (*handler)(void*) = nullptr;
+	void *arg = nullptr;
+};
+
+static std::mutex pins_mutex;
+static std::array<Pin, NUM_PINS> pins;
+
+static std::mutex serials_mutex;
+static std::vector<HardwareSerial*> serials;
+
+static const auto start_time = std::chrono::steady_clock::now();
+static std::atomic<bool> clock_manual{false};
+static std::atomic<uint64_t> clock_us{0};
+
+HardwareSerial console;
+HardwareSerial amplifier;
+
+uint64_t now_us() {
+	if (clock_manual) {
+		return clock_us;
+	}
+
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start_time).count();
+}
+
+void manual_clock(bool manual) {
+	clock_us = now_us();
+	clock_manual = manual;
+}
+
+void advance_us(uint64_t us) {
+	if (clock_manual) {
+		clock_us += us;
+	} else {
+		std::this_thread::sleep_for(std::chrono::microseconds{us});
+	}
+}
+
+void poll() {
+	std::vector<HardwareSerial*> copy;
+
+	{
+		std::lock_guard<std::mutex> lock{serials_mutex};
+		copy = serials;
+	}
+
+	for (auto *serial : copy) {
+		serial->poll();
+	}
+}
+
+static int level(const Pin &state) {
+	if (state.mode == OUTPUT) {
+		return state.output;
+	} else if (state.drive != -1) {
+		return state.drive;
+	} else if (state.mode == INPUT_PULLUP) {
+		return HIGH;
+	} else {
+		return LOW;
+	}
+}
+
+void drive(uint8_t pin, int value) {
+	void (*handler)(void*) = nullptr;
+	void *arg = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock{pins_mutex};
+
+		if (pin >= NUM_PINS) {
+			return;
+		}
+
+		int before = level(pins[pin]);
+
+		pins[pin].drive = value;
+
+		if (level(pins[pin]) != before) {
+			handler = pins[pin].handler;
+			arg = pins[pin].arg;
+		}
+	}
+
+	if (handler) {
+		handler(arg);
+	}
+}
+
+int output(uint8_t pin) {
+	std::lock_guard<std::mutex> lock{pins_mutex};
+
+	if (pin < NUM_PINS && pins[pin].mode == OUTPUT) {
+		return pins[pin].output;
+	}
+
+	return -1;
+}
+
+} // namespace sim
+
+} // namespace ggroohauga
+
+using namespace ggroohauga;
+
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+
+static struct SerialConnections {
+	SerialConnections() {
+		Serial1.connect(sim::console);
+		Serial2.connect(sim::amplifier);
+	}
+} serial_connections;
+
+HardwareSerial::HardwareSerial() {
+	std::lock_guard<std::mutex> lock{sim::serials_mutex};
+	sim::serials.push_back(this);
+}
+
+HardwareSerial::~HardwareSerial() {
+	std::lock_guard<std::mutex> lock{sim::serials_mutex};
+	sim::serials.erase(std::remove(sim::serials.begin(), sim::serials.end(), this),
+		sim::serials.end());
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config,
+		int8_t rx_pin __attribute__((unused)),
+		int8_t tx_pin __attribute__((unused))) {
+	std::lock_guard<std::mutex> lock{mutex_};
+
+	active_ = true;
+	baud_ = baud;
+	/* Start, data, parity and stop bits */
+	bits_ = 1 + (5 + ((config >> 2) & 3)) + ((config & 2) ? 1 : 0)
+		+ (((config >> 4) & 3) == 3 ? 2 : 1);
+	rx_len_ = 0;
+	rx_overflow_ = false;
+	rx_notified_ = 0;
+}
+
+void HardwareSerial::end() {
+	std::lock_guard<std::mutex> lock{mutex_};
+
+	active_ = false;
+	rx_len_ = 0;
+	rx_notified_ = 0;
+	on_receive_ = nullptr;
+}
+
+size_t HardwareSerial::available_locked(uint64_t now_us) const {
+	size_t count = 0;
+
+	while (count < rx_len_
+			&& rx_[(rx_head_ + count) % rx_.size()].time_us <= now_us) {
+		count++;
+	}
+
+	return count;
+}
+
+int HardwareSerial::available() {
+	std::lock_guard<std::mutex> lock{mutex_};
+	return available_locked(sim::now_us());
+}
+
+int HardwareSerial::peek() {
+	std::lock_guard<std::mutex> lock{mutex_};
+
+	if (available_locked(sim::now_us()) == 0) {
+		return -1;
+	}
+
+	return rx_[rx_head_].value;
+}
+
+int HardwareSerial::read() {
+	uint8_t value;
+
+	return read(&value, 1) == 1 ? value : -1;
+}
+
+size_t HardwareSerial::read(uint8_t *buffer, size_t size) {
+	std::lock_guard<std::mutex> lock{mutex_};
+	size_t len = std::min(size, available_locked(sim::now_us()));
+
+	for (size_t i = 0; i < len; i++) {
+		buffer[i] = rx_[rx_head_].value;
+		rx_head_ = (rx_head_ + 1) % rx_.size();
+	}
+
+	rx_len_ -= len;
+
+	rx_notified_ -= std::min(rx_notified_, len);
+	return len;
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+	return write(&value, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+	uint64_t now_us = sim::now_us();
+	HardwareSerial *peer;
+	unsigned long char_us;
+	uint64_t start_us;
+
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+
+		if (!active_) {
+			return 0;
+		}
+
+		peer = peer_;
+		char_us = pacing_ ? char_time_us() : 0;
+
+		/* Reserve the transmit time for all of the data */
+		start_us = std::max(tx_idle_us_, now_us);
+		tx_idle_us_ = start_us + size * char_us;
+	}
+
+	/* The peer is locked separately so that both ends can write at the same time */
+	for (size_t i = 0; peer && i < size; i++) {
+		peer->receive(start_us + (i + 1) * char_us, buffer[i]);
+	}
+
+	return size;
+}
+
+void HardwareSerial::flush() {
+	uint64_t now_us = sim::now_us();
+	uint64_t tx_idle_us;
+
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		tx_idle_us = tx_idle_us_;
+	}
+
+	if (tx_idle_us > now_us) {
+		sim::advance_us(tx_idle_us - now_us);
+	}
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function,
+		bool only_on_timeout __attribute__((unused))) {
+	std::lock_guard<std::mutex> lock{mutex_};
+	on_receive_ = function;
+}
+
+bool HardwareSerial::setRxTimeout(uint8_t symbols __attribute__((unused))) {
+	return true;
+}
+
+bool HardwareSerial::setRxFIFOFull(uint8_t bytes __attribute__((unused))) {
+	return true;
+}
+
+void HardwareSerial::connect(HardwareSerial &peer) {
+	peer_ = &peer;
+	peer.peer_ = this;
+}
+
+void HardwareSerial::pacing(bool enabled) {
+	std::lock_guard<std::mutex> lock{mutex_};
+	pacing_ = enabled;
+}
+
+unsigned long HardwareSerial::char_time_us() const {
+	return baud_ ? (bits_ * 1000000UL + baud_ - 1) / baud_ : 0;
+}
+
+size_t HardwareSerial::tx_queued() const {
+	uint64_t now_us = sim::now_us();
+	std::lock_guard<std::mutex> lock{mutex_};
+	unsigned long char_us = pacing_ ? char_time_us() : 0;
+
+	if (!char_us || tx_idle_us_ <= now_us) {
+		return 0;
+	}
+
+	return (tx_idle_us_ - now_us + char_us - 1) / char_us;
+}
+
+void HardwareSerial::receive(uint64_t time_us, uint8_t value) {
+	std::lock_guard<std::mutex> lock{mutex_};
+
+	if (active_ && rx_len_ < rx_.size()) {
+		rx_[(rx_head_ + rx_len_) % rx_.size()] = {time_us, value};
+		rx_len_++;
+	} else if (active_) {
+		rx_overflow_ = true;
+	}
+}
+
+bool HardwareSerial::rx_overflow() {
+	std::lock_guard<std::mutex> lock{mutex_};
+	bool overflow = rx_overflow_;
+
+	rx_overflow_ = false;
+	return overflow;
+}
+
+void HardwareSerial::poll() {
+	OnReceiveCb function;
+
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		size_t available = available_locked(sim::now_us());
+
+		if (!on_receive_ || available <= rx_notified_) {
+			return;
+		}
+
+		rx_notified_ = available;
+		function = on_receive_;
+	}
+
+	function();
+}
+
+unsigned long millis() {
+	return sim::now_us() / 1000;
+}
+
+unsigned long micros() {
+	return sim::now_us();
+}
+
+void delay(uint32_t ms) {
+	sim::advance_us(ms * 1000ULL);
+}
+
+void yield() {
+	sim::poll();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	std::lock_guard<std::mutex> lock{sim::pins_mutex};
+
+	if (pin < sim::NUM_PINS) {
+		sim::pins[pin].mode = mode;
+	}
+}
+
+int digitalRead(uint8_t pin) {
+	std::lock_guard<std::mutex> lock{sim::pins_mutex};
+
+	if (pin >= sim::NUM_PINS) {
+		return LOW;
+	}
+
+	return sim::level(sim::pins[pin]);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+	std::lock_guard<std::mutex> lock{sim::pins_mutex};
+
+	if (pin < sim::NUM_PINS) {
+		sim::pins[pin].output = value ? HIGH : LOW;
+	}
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void *arg,
+		int mode __attribute__((unused))) {
+	std::lock_guard<std::mutex> lock{sim::pins_mutex};
+
+	if (pin < sim::NUM_PINS) {
+		sim::pins[pin].handler = handler;
+		sim::pins[pin].arg = arg;
+	}
+}
+
+void detachInterrupt(uint8_t pin) {
+	attachInterruptArg(pin, nullptr, nullptr, 0);
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/timer.h"
+
+#include <Arduino.h>
+
+namespace ggroohauga {
+
+Timer::~Timer() {
+	cancel();
+}
+
+void Timer::start(Scheduler &scheduler, unsigned long deadline_us) {
+	if (armed() && scheduler_ != &scheduler) {
+		cancel();
+	}
+
+	deadline_us_ = deadline_us;
+
+	if (armed()) {
+		scheduler.update(*this);
+	} else if (scheduler.add(*this)) {
+		scheduler_ = &scheduler;
+	}
+}
+
+void Timer::cancel() {
+	if (armed()) {
+		scheduler_->remove(*this);
+	}
+}
+
+void Scheduler::run() {
+	unsigned long now_us = ::micros();
+
+	while (size_ > 0 && (long)(now_us - heap_[0]->deadline_us_) >= 0) {
+		Timer *timer = heap_[0];
+
+		/* The callback may start the timer again */
+		remove(*timer);
+		timer->callback_(*timer);
+	}
+}
+
+bool Scheduler::next(unsigned long &remaining_us) const {
+	if (size_ == 0) {
+		return false;
+	}
+
+	long remaining = heap_[0]->deadline_us_ - ::micros();
+
+	remaining_us = remaining > 0 ? remaining : 0;
+	return true;
+}
+
+bool Scheduler::add(Timer &timer) {
+	if (size_ == heap_.size()) {
+		overflow_.add();
+		return false;
+	}
+
+	place(&timer, size_++);
+	sift_up(timer.index_);
+	return true;
+}
+
+void Scheduler::remove(Timer &timer) {
+	size_t index = timer.index_;
+
+	timer.index_ = Timer::NOT_ARMED;
+
+	if (index != --size_) {
+		place(heap_[size_], index);
+		update(*heap_[index]);
+	}
+
+	heap_[size_] = nullptr;
+}
+
+void Scheduler::update(Timer &timer) {
+	sift_up(timer.index_);
+	sift_down(timer.index_);
+}
+
+void Scheduler::place(Timer *timer, size_t index) {
+	heap_[index] = timer;
+	timer->index_ = index;
+}
+
+void Scheduler::sift_up(size_t index) {
+	while (index > 0) {
+		size_t parent = (index - 1) / 2;
+
+		if (!before(heap_[index], heap_[parent])) {
+			break;
+		}
+
+		Timer *timer = heap_[index];
+
+		place(heap_[parent], index);
+		place(timer, parent);
+		index = parent;
+	}
+}
+
+void Scheduler::sift_down(size_t index) {
+	while (true) {
+		size_t first = index;
+		size_t left = index * 2 + 1;
+		size_t right = left + 1;
+
+		if (left < size_ && before(heap_[left], heap_[first])) {
+			first = left;
+		}
+
+		if (right < size_ && before(heap_[right], heap_[first])) {
+			first = right;
+		}
+
+		if (first == index) {
+			break;
+		}
+
+		Timer *timer = heap_[index];
+
+		place(heap_[first], index);
+		place(timer, first);
+		index = first;
+	}
+}
+
+} // namespace ggroohauga
@@ -0,0 +1,232 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/trace.h"
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "ggroohauga/z906.h"
+
+namespace ggroohauga {
+
+static constexpr std::array<std::array<char, 2>, 256> make_hex_table() {
+	constexpr char DIGITS[] = "0123456789ABCDEF";
+	std::array<std::array<char, 2>, 256> table{};
+
+	for (size_t i = 0; i < table.size(); i++) {
+		table[i][0] = DIGITS[i >> 4];
+		table[i][1] = DIGITS[i & 0xF];
+	}
+
+	return table;
+}
+
+/* Both hex digits of every byte value */
+static constexpr std::array<std::array<char, 2>, 256> HEX_TABLE = make_hex_table();
+
+void TraceLine::append(char value) {
+	if (len_ < MAX_LEN) {
+		text_[len_++] = value;
+		text_[len_] = '\0';
+	}
+}
+
+void TraceLine::append(const char *text) {
+	while (*text && len_ < MAX_LEN) {
+		text_[len_++] = *text++;
+	}
+
+	text_[len_] = '\0';
+}
+
+void TraceLine::append(const __FlashStringHelper *text) {
+	append(reinterpret_cast<const char *>(text));
+}
+
+void TraceLine::append(unsigned long value) {
+	std::array<char, 10> digits;
+	size_t count = 0;
+
+	do {
+		digits[count++] = '0' + value % 10;
+		value /= 10;
+	} while (value && count < digits.size());
+
+	while (count > 0 && len_ < MAX_LEN) {
+		text_[len_++] = digits[--count];
+	}
+
+	text_[len_] = '\0';
+}
+
+void TraceLine::append_timestamp(unsigned long timestamp_ms) {
+	unsigned long fraction = timestamp_ms % 1000;
+
+	append(timestamp_ms / 1000);
+	append('.');
+	append(static_cast<char>('0' + fraction / 100));
+	append(static_cast<char>('0' + fraction / 10 % 10));
+	append(static_cast<char>('0' + fraction % 10));
+}
+
+size_t TraceLine::append_hex(const uint8_t *data, size_t len, bool spaced, size_t reserve) {
+	size_t width = spaced ? 3 : 2;
+	size_t available = remaining() > reserve ? remaining() - reserve : 0;
+	char *pos = &text_[len_];
+
+	if (len > available / width) {
+		len = available / width;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		const auto &digits = HEX_TABLE[data[i]];
+
+		if (spaced) {
+			*pos++ = ' ';
+		}
+		*pos++ = digits[0];
+		*pos++ = digits[1];
+	}
+
+	*pos = '\0';
+	len_ += len * width;
+	return len;
+}
+
+namespace {
+
+/* Appends the fields of messages that have them */
+class Annotator: public z906::Listener {
+public:
+	Annotator(TraceLine &line) : line_(line) {}
+
+	void status(const z906::Message &message __attribute__((unused)),
+			const z906::Status &status) override {
+		static const __FlashStringHelper * const CHANNELS[] = {
+			F(" main="), F(" rear="), F(" center="), F(" sub="),
+		};
+		static const __FlashStringHelper * const EFFECTS[] = {
+			F("none"), F("3D"), F("4.1"), F("2.1"),
+		};
+		size_t input = static_cast<size_t>(status.input);
+
+		for (size_t i = 0; i < status.levels.size(); i++) {
+			line_.append(CHANNELS[i]);
+			line_.append(static_cast<unsigned long>(status.levels[i]));
+		}
+
+		line_.append(F(" input="));
+		if (status.input == z906::Input::Aux) {
+			line_.append(F("aux"));
+		} else {
+			line_.append(static_cast<unsigned long>(input + 1));
+		}
+
+		line_.append(F(" effect="));
+		line_.append(EFFECTS[static_cast<size_t>(status.effects[input])]);
+		line_.append(F(" standby="));
+		line_.append(status.standby ? F("on") : F("off"));
+		line_.append(F(" auto-standby="));
+		line_.append(status.auto_standby ? F("on") : F("off"));
+	}
+
+private:
+	TraceLine &line_;
+};
+
+} // namespace
+
+static void annotate(TraceLine &line, const z906::Message &message) {
+	const z906::Opcode *opcode = z906::lookup(message);
+
+	if (opcode) {
+		Annotator annotator{line};
+
+		line.append(opcode->name);
+		opcode->handler(annotator, message, opcode->arg);
+	} else {
+		line.append(message.frame ? F("frame ") : F("command "));
+		line.append_hex(&message.opcode, 1, false);
+	}
+}
+
+void annotate(TraceLine &line, const Frame &frame) {
+	if (frame.empty()) {
+		return;
+	}
+
+	if (frame[0] == z906::FRAME_START) {
+		if (z906::valid_frame(frame.data(), frame.size())) {
+			annotate(line, z906::Message{frame.direction(), frame[1], true,
+				&frame.data()[z906::FRAME_HEADER_LEN], frame[2]});
+		} else {
+			line.append(F("malformed"));
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < frame.size(); i++) {
+		if (i > 0) {
+			line.append(F(", "));
+		}
+
+		annotate(line, z906::Message{frame.direction(), frame[i], false, nullptr, 0});
+	}
+}
+
+size_t format_frame(TraceLine &line, const Frame &frame, size_t pos) {
+	static constexpr size_t DATA_LEN = 8; /* " data=" and one byte */
+	static constexpr size_t DISCARDED_LEN = 12; /* " [discarded]" */
+	static constexpr size_t TRUNCATED_LEN = 3; /* "..." */
+	size_t reserve = DATA_LEN + (frame.discarded() ? DISCARDED_LEN : 0);
+
+	line.clear();
+	line.append_timestamp(frame.timestamp_ms());
+
+	if (pos == 0) {
+		line.append(frame.direction() == Direction::ConsoleToAmplifier
+			? F(" con>amp len=") : F(" amp>con len="));
+		line.append(static_cast<unsigned long>(frame.size()));
+		line.append(' ');
+		annotate(line, frame);
+
+		if (line.remaining() < reserve) {
+			line.truncate(TraceLine::MAX_LEN - reserve - TRUNCATED_LEN);
+			line.append(F("..."));
+		}
+	} else {
+		line.append(F(" +"));
+		line.append(static_cast<unsigned long>(pos));
+	}
+
+	line.append(F(" data="));
+	pos += line.append_hex(&frame.data()[pos], frame.size() - pos, false,
+		frame.discarded() ? DISCARDED_LEN : 0);
+
+	if (frame.discarded()) {
+		line.append(F(" [discarded]"));
+	}
+
+	return pos;
+}
+
+} // namespace ggroohauga
@@ -0,0 +1,280 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/transport.h"
+
+#include <Arduino.h>
+#ifdef ARDUINO_ARCH_ESP32
+# include <driver/gpio.h>
+# include <driver/uart.h>
+# include <esp_idf_version.h>
+# if ESP_IDF_VERSION_MAJOR >= 5
+#  include <esp_private/periph_ctrl.h>
+# else
+#  include <driver/periph_ctrl.h>
+# endif
+# include <hal/uart_ll.h>
+# include <soc/uart_periph.h>
+#endif
+
+#include <algorithm>
+#include <functional>
+
+namespace ggroohauga {
+
+SerialTransport::SerialTransport(HardwareSerial &serial,
+		uint8_t uart_num __attribute__((unused)),
+		uint8_t rx_pin, uint8_t tx_pin)
+		: serial_(serial), rx_pin_(rx_pin), tx_pin_(tx_pin) {
+}
+
+void SerialTransport::begin(unsigned long baud, uint32_t config) {
+	serial_.begin(baud, config, rx_pin_, tx_pin_);
+#ifdef ARDUINO_ARCH_ESP32
+	/* Serial event task */
+	serial_.onReceiveError([this] (hardwareSerial_error_t error) {
+		if (error == UART_FIFO_OVF_ERROR || error == UART_BUFFER_FULL_ERROR) {
+			stats_.rx_overflows.add();
+		}
+	});
+#endif
+}
+
+void SerialTransport::end() {
+	serial_.end();
+}
+
+void SerialTransport::on_receive(std::function<void()> function,
+		uint8_t timeout_symbols, uint8_t fifo_full) {
+	if (function) {
+		serial_.setRxTimeout(timeout_symbols);
+		serial_.setRxFIFOFull(fifo_full);
+		serial_.onReceive(function);
+	} else {
+		serial_.onReceive(nullptr);
+	}
+}
+
+size_t SerialTransport::available() {
+	int available = serial_.available();
+
+#ifdef GGROOHAUGA_SIMULATION
+	if (serial_.rx_overflow()) {
+		stats_.rx_overflows.add();
+	}
+#endif
+
+	return available > 0 ? available : 0;
+}
+
+size_t SerialTransport::read(uint8_t *data, size_t len) {
+	return serial_.read(data, len);
+}
+
+size_t SerialTransport::write(const uint8_t *data, size_t len) {
+	return serial_.write(data, len);
+}
+
+void SerialTransport::clear_stats() {
+	stats_.rx_overflows.clear();
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+FifoTransport::FifoTransport(HardwareSerial &serial __attribute__((unused)),
+		uint8_t uart_num, uint8_t rx_pin, uint8_t tx_pin)
+		: uart_num_(uart_num), hw_(UART_LL_GET_HW(uart_num)),
+		rx_pin_(rx_pin), tx_pin_(tx_pin) {
+}
+
+void FifoTransport::begin(unsigned long baud, uint32_t config) {
+	uart_config_t uart_config{};
+
+	/* Arduino serial configs use the same bits as the UART register */
+	uart_config.baud_rate = baud;
+	uart_config.data_bits = static_cast<uart_word_length_t>((config >> 2) & 3);
+	uart_config.parity = static_cast<uart_parity_t>(config & 3);
+	uart_config.stop_bits = static_cast<uart_stop_bits_t>((config >> 4) & 3);
+	uart_config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+#if ESP_IDF_VERSION_MAJOR >= 5
+	uart_config.source_clk = UART_SCLK_DEFAULT;
+#else
+	uart_config.source_clk = UART_SCLK_APB;
+#endif
+
+	/*
+	 * The driver only enables the UART module the first time it's
+	 * configured, so it needs to be enabled again after end().
+	 */
+	if (module_disabled_) {
+		periph_module_enable(uart_periph_signal[uart_num_].module);
+		module_disabled_ = false;
+	}
+
+	/* Configure the UART without installing the driver */
+	uart_param_config(uart_num_, &uart_config);
+	uart_set_pin(uart_num_, tx_pin_, rx_pin_, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+	uart_ll_disable_intr_mask(hw_, UART_LL_INTR_MASK);
+	uart_ll_clr_intsts_mask(hw_, UART_LL_INTR_MASK);
+	uart_ll_rxfifo_rst(hw_);
+	uart_ll_txfifo_rst(hw_);
+
+	tx_head_ = 0;
+	tx_len_ = 0;
+	active_ = true;
+}
+
+void FifoTransport::end() {
+	if (!active_) {
+		return;
+	}
+
+	active_ = false;
+
+	/* Stop the UART (this resets its configuration) and disconnect the pins */
+	uart_ll_disable_intr_mask(hw_, UART_LL_INTR_MASK);
+	uart_ll_clr_intsts_mask(hw_, UART_LL_INTR_MASK);
+	periph_module_disable(uart_periph_signal[uart_num_].module);
+	module_disabled_ = true;
+
+	gpio_reset_pin(static_cast<gpio_num_t>(rx_pin_));
+	gpio_reset_pin(static_cast<gpio_num_t>(tx_pin_));
+}
+
+void FifoTransport::check_overflow() {
+	if (uart_ll_get_intraw_mask(hw_) & UART_INTR_RXFIFO_OVF) {
+		uart_ll_clr_intsts_mask(hw_, UART_INTR_RXFIFO_OVF);
+		stats_.rx_overflows.add();
+	}
+}
+
+size_t FifoTransport::available() {
+	if (!active_) {
+		return 0;
+	}
+
+	check_overflow();
+	return uart_ll_get_rxfifo_len(hw_);
+}
+
+size_t FifoTransport::read(uint8_t *data, size_t len) {
+	len = std::min(len, available());
+	uart_ll_read_rxfifo(hw_, data, len);
+	return len;
+}
+
+size_t FifoTransport::tx_free() {
+	return uart_ll_get_txfifo_len(hw_);
+}
+
+void FifoTransport::tx_fifo(const uint8_t *data, size_t len) {
+	uart_ll_write_txfifo(hw_, data, len);
+}
+#else
+FifoTransport::FifoTransport(HardwareSerial &serial,
+		uint8_t uart_num __attribute__((unused)),
+		uint8_t rx_pin, uint8_t tx_pin)
+		: serial_(serial), rx_pin_(rx_pin), tx_pin_(tx_pin) {
+}
+
+void FifoTransport::begin(unsigned long baud, uint32_t config) {
+	serial_.begin(baud, config, rx_pin_, tx_pin_);
+
+	tx_head_ = 0;
+	tx_len_ = 0;
+	active_ = true;
+}
+
+void FifoTransport::end() {
+	active_ = false;
+
+	serial_.end();
+}
+
+void FifoTransport::check_overflow() {
+	if (serial_.rx_overflow()) {
+		stats_.rx_overflows.add();
+	}
+}
+
+size_t FifoTransport::available() {
+	int available;
+
+	if (!active_) {
+		return 0;
+	}
+
+	check_overflow();
+	available = serial_.available();
+
+	return available > 0 ? std::min(static_cast<size_t>(available), FIFO_SIZE) : 0;
+}
+
+size_t FifoTransport::read(uint8_t *data, size_t len) {
+	return serial_.read(data, std::min(len, available()));
+}
+
+size_t FifoTransport::tx_free() {
+	return FIFO_SIZE - std::min(serial_.tx_queued(), FIFO_SIZE);
+}
+
+void FifoTransport::tx_fifo(const uint8_t *data, size_t len) {
+	serial_.write(data, len);
+}
+#endif
+
+size_t FifoTransport::write(const uint8_t *data, size_t len) {
+	size_t written = 0;
+
+	if (!active_) {
+		return 0;
+	}
+
+	poll();
+
+	if (tx_len_ == 0) {
+		written = std::min(len, tx_free());
+		tx_fifo(data, written);
+	}
+
+	while (written < len && tx_len_ < tx_buffer_.size()) {
+		tx_buffer_[(tx_head_ + tx_len_) % tx_buffer_.size()] = data[written++];
+		tx_len_++;
+	}
+
+	return written;
+}
+
+void FifoTransport::clear_stats() {
+	stats_.rx_overflows.clear();
+}
+
+void FifoTransport::poll() {
+	while (active_ && tx_len_ > 0) {
+		size_t len = std::min({tx_len_, tx_free(), tx_buffer_.size() - tx_head_});
+
+		if (len == 0) {
+			break;
+		}
+
+		tx_fifo(&tx_buffer_[tx_head_], len);
+		tx_head_ = (tx_head_ + len) % tx_buffer_.size();
+		tx_len_ -= len;
+	}
+}
+
+} // namespace ggroohauga
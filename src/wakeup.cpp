@@ -0,0 +1,140 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/wakeup.h"
+
+#include <Arduino.h>
+#ifdef ARDUINO_ARCH_ESP32
+# include <freertos/FreeRTOS.h>
+# include <freertos/semphr.h>
+#else
+# include <chrono>
+# include <condition_variable>
+# include <mutex>
+#endif
+
+#include <algorithm>
+
+namespace ggroohauga {
+
+#ifdef ARDUINO_ARCH_ESP32
+Wakeup::Wakeup() : semaphore_(xSemaphoreCreateBinaryStatic(&buffer_)) {
+}
+
+Wakeup::~Wakeup() {
+	vSemaphoreDelete(semaphore_);
+}
+
+void Wakeup::notify() {
+	notified();
+	xSemaphoreGive(semaphore_);
+}
+
+void ARDUINO_ISR_ATTR Wakeup::notify_from_isr() {
+	BaseType_t woken = pdFALSE;
+
+	notified();
+	xSemaphoreGiveFromISR(semaphore_, &woken);
+	if (woken) {
+		portYIELD_FROM_ISR();
+	}
+}
+#else
+Wakeup::Wakeup() {
+}
+
+Wakeup::~Wakeup() {
+}
+
+void Wakeup::notify() {
+	notified();
+
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		notified_ = true;
+	}
+
+	cv_.notify_one();
+}
+
+void Wakeup::notify_from_isr() {
+	notify();
+}
+#endif
+
+void ARDUINO_ISR_ATTR Wakeup::notified() {
+	if (!pending_.exchange(true, std::memory_order_relaxed)) {
+		notify_us_.store(::micros(), std::memory_order_relaxed);
+	}
+}
+
+bool Wakeup::wait(unsigned long timeout_us) {
+	unsigned long start_us = ::micros();
+	bool woken;
+
+#ifdef ARDUINO_ARCH_ESP32
+	/* Round up so that the wait is never shorter than requested */
+	woken = xSemaphoreTake(semaphore_,
+		(timeout_us + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000)) == pdTRUE;
+#else
+	{
+		std::unique_lock<std::mutex> lock{mutex_};
+
+		woken = cv_.wait_for(lock, std::chrono::microseconds{timeout_us},
+			[this] { return notified_; });
+		notified_ = false;
+	}
+#endif
+
+	unsigned long end_us = ::micros();
+
+	stats_.waits.add();
+	idle_us_ += end_us - start_us;
+	stats_.idle_ms.add(idle_us_ / 1000);
+	idle_us_ %= 1000;
+
+	if (pending_.exchange(false, std::memory_order_relaxed)) {
+		stats_.latency_us.add(end_us - notify_us_.load(std::memory_order_relaxed));
+	}
+
+	if (woken) {
+		stats_.wakeups.add();
+	}
+
+	return woken;
+}
+
+unsigned long Wakeup::idle_permille() const {
+	unsigned long elapsed_ms = ::millis() - cleared_ms_.load(std::memory_order_relaxed);
+
+	if (!elapsed_ms) {
+		return 0;
+	}
+
+	return std::min(1000ULL, stats_.idle_ms.get() * 1000ULL / elapsed_ms);
+}
+
+void Wakeup::clear_stats() {
+	stats_.waits.clear();
+	stats_.wakeups.clear();
+	stats_.idle_ms.clear();
+	stats_.latency_us.clear();
+	cleared_ms_.store(::millis(), std::memory_order_relaxed);
+}
+
+} // namespace ggroohauga
@@ -0,0 +1,359 @@
+/*
+ * ggroohauga - Alternative console and simulated amplifier interface
+ * Copyright 2026  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ggroohauga/z906.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+namespace ggroohauga {
+
+namespace z906 {
+
+/* Offsets into the data of a status frame */
+static constexpr size_t STATUS_LEVELS = 0;
+static constexpr size_t STATUS_INPUT = 4;
+static constexpr std::array<size_t, Status::NUM_INPUTS> STATUS_EFFECTS{10, 8, 11, 6, 7, 9};
+static constexpr size_t STATUS_SPDIF = 12;
+static constexpr size_t STATUS_SIGNAL = 13;
+static constexpr size_t STATUS_VERSION = 14;
+static constexpr size_t STATUS_STANDBY = 17;
+static constexpr size_t STATUS_AUTO_STANDBY = 18;
+
+static constexpr std::array<Effect, 4> STATUS_EFFECT_VALUES{
+	Effect::Effect3D, Effect::Effect4_1, Effect::Effect2_1, Effect::None};
+
+static constexpr uint8_t level_arg(Channel channel, bool up) {
+	return (static_cast<uint8_t>(channel) << 1) | (up ? 1 : 0);
+}
+
+static void handle_input(Listener &listener, const Message &message, uint8_t arg) {
+	listener.input(message, static_cast<Input>(arg));
+}
+
+static void handle_level(Listener &listener, const Message &message, uint8_t arg) {
+	listener.level(message, static_cast<Channel>(arg >> 1), arg & 1);
+}
+
+static void handle_power(Listener &listener, const Message &message, uint8_t arg) {
+	listener.power(message, arg);
+}
+
+static void handle_effect(Listener &listener, const Message &message, uint8_t arg) {
+	listener.effect(message, static_cast<Effect>(arg));
+}
+
+static void handle_mute(Listener &listener, const Message &message, uint8_t arg) {
+	listener.mute(message, arg);
+}
+
+static void handle_query(Listener &listener, const Message &message, uint8_t arg) {
+	listener.query(message, static_cast<Query>(arg));
+}
+
+static void handle_control(Listener &listener, const Message &message, uint8_t arg) {
+	listener.control(message, static_cast<Control>(arg));
+}
+
+static void handle_status(Listener &listener, const Message &message,
+		uint8_t arg __attribute__((unused))) {
+	Status status;
+
+	if (message.length < STATUS_LEN) {
+		listener.unknown(message);
+		return;
+	}
+
+	for (size_t i = 0; i < status.levels.size(); i++) {
+		status.levels[i] = message.data[STATUS_LEVELS + i];
+	}
+
+	status.input = static_cast<Input>(std::min<uint8_t>(
+		message.data[STATUS_INPUT], static_cast<uint8_t>(Input::Aux)));
+
+	for (size_t i = 0; i < status.effects.size(); i++) {
+		uint8_t value = message.data[STATUS_EFFECTS[i]];
+
+		status.effects[i] = value < STATUS_EFFECT_VALUES.size()
+			? STATUS_EFFECT_VALUES[value] : Effect::None;
+	}
+
+	status.spdif_status = message.data[STATUS_SPDIF];
+	status.signal_status = message.data[STATUS_SIGNAL];
+
+	for (size_t i = 0; i < status.version.size(); i++) {
+		status.version[i] = message.data[STATUS_VERSION + i];
+	}
+
+	status.standby = message.data[STATUS_STANDBY];
+	status.auto_standby = message.data[STATUS_AUTO_STANDBY];
+
+	listener.status(message, status);
+}
+
+void encode_status(const Status &status, uint8_t *data) {
+	for (size_t i = 0; i < status.levels.size(); i++) {
+		data[STATUS_LEVELS + i] = status.levels[i];
+	}
+
+	data[STATUS_INPUT] = static_cast<uint8_t>(status.input);
+
+	for (size_t i = 0; i < status.effects.size(); i++) {
+		auto it = std::find(STATUS_EFFECT_VALUES.begin(),
+			STATUS_EFFECT_VALUES.end(), status.effects[i]);
+
+		data[STATUS_EFFECTS[i]] = it - STATUS_EFFECT_VALUES.begin();
+	}
+
+	data[STATUS_SPDIF] = status.spdif_status;
+	data[STATUS_SIGNAL] = status.signal_status;
+
+	for (size_t i = 0; i < status.version.size(); i++) {
+		data[STATUS_VERSION + i] = status.version[i];
+	}
+
+	data[STATUS_STANDBY] = status.standby;
+	data[STATUS_AUTO_STANDBY] = status.auto_standby;
+}
+
+static constexpr Opcode COMMANDS[] = {
+	{ 0x02, false, "input-1", handle_input, static_cast<uint8_t>(Input::Input1) },
+	{ 0x05, false, "input-2", handle_input, static_cast<uint8_t>(Input::Input2) },
+	{ 0x03, false, "input-3", handle_input, static_cast<uint8_t>(Input::Input3) },
+	{ 0x04, false, "input-4", handle_input, static_cast<uint8_t>(Input::Input4) },
+	{ 0x06, false, "input-5", handle_input, static_cast<uint8_t>(Input::Input5) },
+	{ 0x07, false, "input-aux", handle_input, static_cast<uint8_t>(Input::Aux) },
+	{ 0x08, false, "main-level-up", handle_level, level_arg(Channel::Main, true) },
+	{ 0x09, false, "main-level-down", handle_level, level_arg(Channel::Main, false) },
+	{ 0x0A, false, "sub-level-up", handle_level, level_arg(Channel::Sub, true) },
+	{ 0x0B, false, "sub-level-down", handle_level, level_arg(Channel::Sub, false) },
+	{ 0x0C, false, "center-level-up", handle_level, level_arg(Channel::Center, true) },
+	{ 0x0D, false, "center-level-down", handle_level, level_arg(Channel::Center, false) },
+	{ 0x0E, false, "rear-level-up", handle_level, level_arg(Channel::Rear, true) },
+	{ 0x0F, false, "rear-level-down", handle_level, level_arg(Channel::Rear, false) },
+	{ 0x10, false, "power-off", handle_power, false },
+	{ 0x11, false, "power-on", handle_power, true },
+	{ 0x14, false, "effect-3D", handle_effect, static_cast<uint8_t>(Effect::Effect3D) },
+	{ 0x15, false, "effect-4.1", handle_effect, static_cast<uint8_t>(Effect::Effect4_1) },
+	{ 0x16, false, "effect-2.1", handle_effect, static_cast<uint8_t>(Effect::Effect2_1) },
+	{ 0x22, false, "block-inputs", handle_control, static_cast<uint8_t>(Control::BlockInputs) },
+	{ 0x25, false, "get-temperature", handle_query, static_cast<uint8_t>(Query::Temperature) },
+	{ 0x30, false, "reset-power-up-time", handle_control, static_cast<uint8_t>(Control::ResetPowerUpTime) },
+	{ 0x31, false, "get-power-up-time", handle_query, static_cast<uint8_t>(Query::PowerUpTime) },
+	{ 0x33, false, "unblock-inputs", handle_control, static_cast<uint8_t>(Control::UnblockInputs) },
+	{ 0x34, false, "get-status", handle_query, static_cast<uint8_t>(Query::Status) },
+	{ 0x35, false, "effect-none", handle_effect, static_cast<uint8_t>(Effect::None) },
+	{ 0x36, false, "save", handle_control, static_cast<uint8_t>(Control::Save) },
+	{ 0x38, false, "mute-on", handle_mute, true },
+	{ 0x39, false, "mute-off", handle_mute, false },
+	{ 0xF0, false, "get-version", handle_query, static_cast<uint8_t>(Query::Version) },
+};
+
+static constexpr Opcode FRAMES[] = {
+	{ STATUS_TYPE, true, "status", handle_status, 0 },
+};
+
+static constexpr uint8_t NO_OPCODE = UINT8_MAX;
+
+template<size_t N>
+static constexpr std::array<uint8_t, 256> make_index(const Opcode (&opcodes)[N]) {
+	static_assert(N < NO_OPCODE, "Too many opcodes");
+	std::array<uint8_t, 256> index{};
+
+	for (size_t i = 0; i < index.size(); i++) {
+		index[i] = NO_OPCODE;
+	}
+
+	for (size_t i = 0; i < N; i++) {
+		index[opcodes[i].value] = i;
+	}
+
+	return index;
+}
+
+static constexpr auto COMMAND_INDEX = make_index(COMMANDS);
+static constexpr auto FRAME_INDEX = make_index(FRAMES);
+
+const Opcode *lookup(const Message &message) {
+	if (message.frame) {
+		uint8_t pos = FRAME_INDEX[message.opcode];
+
+		return pos != NO_OPCODE ? &FRAMES[pos] : nullptr;
+	} else {
+		uint8_t pos = COMMAND_INDEX[message.opcode];
+
+		return pos != NO_OPCODE ? &COMMANDS[pos] : nullptr;
+	}
+}
+
+void dispatch(Listener &listener, const Message &message) {
+	const Opcode *opcode = lookup(message);
+
+	if (opcode) {
+		opcode->handler(listener, message, opcode->arg);
+	} else {
+		listener.unknown(message);
+	}
+}
+
+bool idempotent(const Message &message) {
+	const Opcode *opcode = lookup(message);
+
+	return opcode && opcode->handler == handle_query;
+}
+
+const Opcode *find_command(const char *name) {
+	for (const auto &opcode : COMMANDS) {
+		if (!std::strcmp(opcode.name, name)) {
+			return &opcode;
+		}
+	}
+
+	return nullptr;
+}
+
+void for_each_command(const std::function<void(const Opcode &opcode)> &func) {
+	for (const auto &opcode : COMMANDS) {
+		func(opcode);
+	}
+}
+
+static constexpr uint8_t find_opcode(
+		void (*handler)(Listener &listener, const Message &message, uint8_t arg),
+		uint8_t arg) {
+	for (const auto &opcode : COMMANDS) {
+		if (opcode.handler == handler && opcode.arg == arg) {
+			return opcode.value;
+		}
+	}
+
+	return NO_OPCODE;
+}
+
+uint8_t input_opcode(Input input) {
+	return find_opcode(handle_input, static_cast<uint8_t>(input));
+}
+
+uint8_t level_opcode(Channel channel, bool up) {
+	return find_opcode(handle_level, level_arg(channel, up));
+}
+
+uint8_t power_opcode(bool on) {
+	return find_opcode(handle_power, on);
+}
+
+uint8_t effect_opcode(Effect effect) {
+	return find_opcode(handle_effect, static_cast<uint8_t>(effect));
+}
+
+uint8_t mute_opcode(bool on) {
+	return find_opcode(handle_mute, on);
+}
+
+uint8_t query_opcode(Query query) {
+	return find_opcode(handle_query, static_cast<uint8_t>(query));
+}
+
+uint8_t control_opcode(Control control) {
+	return find_opcode(handle_control, static_cast<uint8_t>(control));
+}
+
+Decoder::Result Decoder::feed(uint8_t value) {
+	if (frame_.state == State::Idle) {
+		if (value == FRAME_START) {
+			frame_.start();
+			inner_.state = State::Idle;
+			length_ = 1;
+			return Result::Incomplete;
+		}
+		return Result::Command;
+	}
+
+	if (inner_.state != State::Idle) {
+		if (inner_.feed(value) != Step::Incomplete) {
+			/* Too short to resync, try the next frame start instead */
+			inner_.state = State::Idle;
+		}
+	} else if (value == FRAME_START) {
+		inner_.start();
+		restart_ = length_;
+	}
+
+	length_++;
+
+	switch (frame_.feed(value)) {
+	case Step::Incomplete:
+		break;
+
+	case Step::Valid:
+		inner_.state = State::Idle;
+		return Result::Frame;
+
+	case Step::Invalid:
+		if (inner_.state != State::Idle) {
+			frame_ = inner_;
+			inner_.state = State::Idle;
+			length_ -= restart_;
+			return Result::Resync;
+		}
+		return Result::Malformed;
+	}
+
+	return Result::Incomplete;
+}
+
+Decoder::Step Decoder::Parser::feed(uint8_t value) {
+	switch (state) {
+	case State::Idle:
+		break;
+
+	case State::Type:
+		checksum = value;
+		state = State::Length;
+		break;
+
+	case State::Length:
+		checksum += value;
+		remaining = value;
+		state = remaining ? State::Data : State::Checksum;
+		break;
+
+	case State::Data:
+		checksum += value;
+		if (--remaining == 0) {
+			state = State::Checksum;
+		}
+		break;
+
+	case State::Checksum:
+		state = State::Idle;
+		return value == checksum ? Step::Valid : Step::Invalid;
+	}
+
+	return Step::Incomplete;
+}
+
+} // namespace z906
+
+} // namespace ggroohauga
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+# ggroohauga - Alternative console and simulated amplifier interface
+# Copyright 2026  Simon Arlott
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Compare benchmark results (from a simulation build with
+GGROOHAUGA_BENCHMARK=1) with a baseline and fail if any of them are slower
+than the threshold"""
+
+import argparse
+import json
+import sys
+
+DEFAULT_BASELINE = "benchmark_baseline.json"
+DEFAULT_THRESHOLD = 10
+
+
+def load_results(f):
+	"""Read one JSON object per line"""
+	results = {}
+	for line in f:
+		line = line.strip()
+		if line.startswith("{"):
+			result = json.loads(line)
+			results[result["name"]] = result
+	return results
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__)
+	parser.add_argument("results", nargs="?", default="-", help="Benchmark output")
+	parser.add_argument("-b", "--baseline", default=DEFAULT_BASELINE, help="Baseline file")
+	parser.add_argument("-t", "--threshold", type=float, default=DEFAULT_THRESHOLD,
+		help="Maximum increase in cycles per byte (percent)")
+	parser.add_argument("-u", "--update", action="store_true", help="Replace the baseline with these results")
+	args = parser.parse_args()
+
+	if args.results == "-":
+		results = load_results(sys.stdin)
+	else:
+		with open(args.results, "r") as f:
+			results = load_results(f)
+
+	if args.update:
+		baseline = {name: {"cycles_per_byte": result["cycles_per_byte"], "unit": result["unit"]}
+			for (name, result) in sorted(results.items())}
+		with open(args.baseline, "w") as f:
+			json.dump(baseline, f, indent="\t", sort_keys=True)
+			f.write("\n")
+		return 0
+
+	try:
+		with open(args.baseline, "r") as f:
+			baseline = json.load(f)
+	except FileNotFoundError:
+		print(f"No baseline file {args.baseline} (record one with --update)", file=sys.stderr)
+		return 2
+
+	if not results:
+		print("No benchmark results", file=sys.stderr)
+		return 2
+
+	failed = 0
+	for (name, result) in sorted(results.items()):
+		value = result["cycles_per_byte"]
+
+		if name not in baseline:
+			print(f"{name:32} {value:10.3f} (no baseline)")
+			continue
+
+		expected = baseline[name]
+		if expected["unit"] != result["unit"]:
+			print(f"{name:32} {value:10.3f} (baseline unit {expected['unit']} != {result['unit']})")
+			failed += 1
+			continue
+
+		change = (value / expected["cycles_per_byte"] - 1) * 100 if expected["cycles_per_byte"] else 0
+		status = "FAIL" if change > args.threshold else "ok"
+		if status == "FAIL":
+			failed += 1
+		print(f"{name:32} {value:10.3f} {expected['cycles_per_byte']:10.3f} {change:+7.1f}% {status}")
+
+	for name in sorted(baseline.keys() - results.keys()):
+		print(f"{name:32} missing")
+		failed += 1
+
+	return 1 if failed else 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+# ggroohauga - Alternative console and simulated amplifier interface
+# Copyright 2026  Simon Arlott
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Decode a bus capture file or the output of the "capture dump" command"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = b"GGRHCAP\x01"
+RECORD_HEADER = struct.Struct("<IBBH")
+
+RECORD_FRAME = 0
+RECORD_PIN = 1
+
+FLAG_AMPLIFIER_TO_CONSOLE = 1 << 0
+FLAG_DISCARDED = 1 << 1
+FLAG_HIGH = 1 << 0
+
+DUMP_LINE = re.compile(r"^([0-9A-F]{8}): ([0-9A-F]*)$")
+
+
+def load(data):
+	"""Convert "capture dump" output to binary, if necessary"""
+	if data.startswith(MAGIC):
+		return data
+
+	output = bytearray()
+	for line in data.decode("utf-8", "replace").splitlines():
+		match = DUMP_LINE.match(line.strip())
+		if match:
+			if int(match.group(1), 16) != len(output):
+				raise ValueError(f"Missing data at offset {len(output):08X}")
+			output += bytes.fromhex(match.group(2))
+	return bytes(output)
+
+
+def records(data):
+	"""Yield (time_us, type, flags, data) for each record"""
+	pos = 0
+	last_time_us = None
+
+	while pos < len(data):
+		if data[pos:pos + len(MAGIC)] == MAGIC:
+			pos += len(MAGIC)
+			continue
+
+		if pos + RECORD_HEADER.size > len(data):
+			raise ValueError(f"Truncated record header at offset {pos:08X}")
+
+		(time_us, type, flags, length) = RECORD_HEADER.unpack_from(data, pos)
+		pos += RECORD_HEADER.size
+
+		if pos + length > len(data):
+			raise ValueError(f"Truncated record data at offset {pos:08X}")
+
+		# Frames are recorded with their start time when they end, so records
+		# can be slightly out of order; only a backwards step of more than
+		# half the 32-bit range is a wrap of the microsecond timer
+		if last_time_us is None:
+			last_time_us = time_us
+		else:
+			delta = (time_us - last_time_us) & 0xFFFFFFFF
+			if delta >= 1 << 31:
+				delta -= 1 << 32
+			last_time_us += delta
+
+		yield (last_time_us, type, flags, data[pos:pos + length])
+		pos += length
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__)
+	parser.add_argument("file", nargs="?", default="-", help="Capture file or dump output")
+	args = parser.parse_args()
+
+	if args.file == "-":
+		data = sys.stdin.buffer.read()
+	else:
+		with open(args.file, "rb") as f:
+			data = f.read()
+
+	start_us = None
+	for (time_us, type, flags, payload) in records(load(data)):
+		if start_us is None:
+			start_us = time_us
+		time_s = (time_us - start_us) / 1000000
+
+		if type == RECORD_FRAME:
+			direction = "amplifier" if flags & FLAG_AMPLIFIER_TO_CONSOLE else "console"
+			discarded = " [discarded]" if flags & FLAG_DISCARDED else ""
+			print(f"{time_s:12.6f} {direction:9} {payload.hex(' ').upper()}{discarded}")
+		elif type == RECORD_PIN:
+			value = "HIGH" if flags & FLAG_HIGH else "LOW"
+			print(f"{time_s:12.6f} {'pin':9} {payload[0]} {value}")
+		else:
+			print(f"{time_s:12.6f} {'unknown':9} type {type} flags {flags:02X} {payload.hex(' ').upper()}")
+
+
+if __name__ == "__main__":
+	main()